@@ -0,0 +1,87 @@
+/**
+ * @file bvh_benchmark.cpp
+ * @brief Compares the memory and traversal cost of BVH_node trees and of
+ * their Compressed_BVH copies
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "arena.hpp"
+#include "bounding_volume_hierarchy.hpp"
+#include "compressed_bvh.hpp"
+#include "random.hpp"
+#include "ray.hpp"
+#include "sampling.hpp"
+#include "sphere.hpp"
+
+namespace {
+constexpr int sphere_count = 100'000;
+constexpr int ray_count = 2'000'000;
+
+// Keeps the optimizer from removing the benchmarked work
+volatile float sink;
+
+size_t node_count(const Hitable* hitable)
+{
+  const auto node = dynamic_cast<const BVH_node*>(hitable);
+  return node ? 1 + node_count(node->left()) + node_count(node->right()) : 0;
+}
+
+void benchmark(const char* name, const Hitable& bvh,
+               const std::vector<Ray>& rays, size_t bytes)
+{
+  using namespace std::chrono;
+
+  const auto start = steady_clock::now();
+  float sum = 0;
+  int hits = 0;
+  for (const auto& ray : rays) {
+    if (const auto intersection = bvh.intersect_at(
+            ray, 0.001f, std::numeric_limits<float>::infinity())) {
+      sum += intersection->t;
+      ++hits;
+    }
+  }
+  const auto end = steady_clock::now();
+  sink = sum;
+
+  const auto ns = duration_cast<nanoseconds>(end - start).count();
+  std::printf("%-16s %8.2f MB %8.1f ns/ray (%d hits)\n", name,
+              static_cast<double>(bytes) / (1 << 20),
+              static_cast<double>(ns) / rays.size(), hits);
+}
+} // anonymous namespace
+
+int main()
+{
+  Arena arena;
+  const auto& material = *arena.create<Lambertian>(Color(0.5f, 0.5f, 0.5f));
+  Pcg32 rng;
+  std::vector<Hitable*> objects;
+  for (int i = 0; i < sphere_count; ++i) {
+    const Point3f center{1000 * rng.next_float(), 1000 * rng.next_float(),
+                         1000 * rng.next_float()};
+    objects.push_back(arena.create<Sphere>(center, 2, material));
+  }
+  const auto bvh =
+      arena.create<BVH_node>(arena, objects.begin(), objects.end());
+  const Compressed_BVH compressed{arena, *bvh};
+
+  std::vector<Ray> rays;
+  rays.reserve(ray_count);
+  for (int i = 0; i < ray_count; ++i) {
+    const Point3f origin{1000 * rng.next_float(), 1000 * rng.next_float(),
+                         1000 * rng.next_float()};
+    const auto direction = uniform_sample_sphere(
+        Point2f{rng.next_float(), rng.next_float()});
+    rays.emplace_back(origin, direction);
+  }
+
+  benchmark("BVH_node", *bvh, rays, node_count(bvh) * sizeof(BVH_node));
+  benchmark("Compressed_BVH", compressed, rays, compressed.memory_size());
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file rng_benchmark.cpp
+ * @brief Measures the cost of the random numbers a path sample consumes
+ *
+ * Compares the thread_local std::mt19937 with standard distributions that the
+ * renderer used to draw from against PCG32 and the Philox-based Sampler.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "random.hpp"
+#include "sampler.hpp"
+#include "sampling.hpp"
+
+namespace {
+constexpr int iterations = 20'000'000;
+
+// Keeps the optimizer from removing the benchmarked work
+volatile float sink;
+
+template <typename F> void benchmark(const char* name, F f)
+{
+  using namespace std::chrono;
+
+  const auto start = steady_clock::now();
+  float sum = 0;
+  for (int i = 0; i < iterations; ++i) {
+    sum += f(i);
+  }
+  const auto end = steady_clock::now();
+  sink = sum;
+
+  const auto ns = duration_cast<nanoseconds>(end - start).count();
+  std::printf("%-44s %6.2f ns\n", name, static_cast<double>(ns) / iterations);
+}
+
+// The unit ball sampling of the old Lambertian::scatter
+Vec3f mt19937_in_unit_sphere()
+{
+  thread_local std::mt19937 gen = std::mt19937{std::random_device{}()};
+  thread_local std::uniform_real_distribution<float> uni(-1, 1);
+  thread_local std::normal_distribution<float> normal(0, 1);
+
+  Vec3f p{normal(gen), normal(gen), normal(gen)};
+  p = normalize(p);
+  return p * std::cbrt(uni(gen));
+}
+} // anonymous namespace
+
+int main()
+{
+  std::puts("Per call cost:");
+
+  benchmark("mt19937 + uniform_real_distribution", [](int) {
+    thread_local std::mt19937 gen = std::mt19937{std::random_device{}()};
+    std::uniform_real_distribution<float> dis(0.0, 1.0);
+    return dis(gen);
+  });
+
+  Pcg32 pcg;
+  benchmark("Pcg32::next_float", [&pcg](int) { return pcg.next_float(); });
+
+  benchmark("Sampler::next_1d (fresh sampler, 1 number)", [](int i) {
+    return Sampler{0, static_cast<unsigned>(i), 0}.next_1d();
+  });
+
+  Sampler sampler{0, 0, 0};
+  benchmark("Sampler::next_1d (same sampler)",
+            [&sampler](int) { return sampler.next_1d(); });
+
+  std::puts("\nDiffuse bounce direction:");
+
+  benchmark("mt19937, 3 normals + cbrt (old)",
+            [](int) { return mt19937_in_unit_sphere().x; });
+
+  benchmark("Sampler + uniform_sample_sphere", [&sampler](int) {
+    return uniform_sample_sphere(sampler.next_2d()).x;
+  });
+
+  benchmark("Sampler + cosine_sample_hemisphere", [&sampler](int) {
+    return cosine_sample_hemisphere(sampler.next_2d()).x;
+  });
+
+  return 0;
+}
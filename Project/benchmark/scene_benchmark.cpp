@@ -0,0 +1,62 @@
+/**
+ * @file scene_benchmark.cpp
+ * @brief Measures the cost of building and tearing down a large scene
+ *
+ * Primitives, BVH nodes and materials are created in the arena of the scene,
+ * which is released at once when the scene is destroyed.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "arena.hpp"
+#include "bounding_volume_hierarchy.hpp"
+#include "random.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+
+namespace {
+constexpr int sphere_count = 200'000;
+
+double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now() - start).count();
+}
+} // anonymous namespace
+
+int main()
+{
+  using std::chrono::steady_clock;
+
+  auto start = steady_clock::now();
+  Arena arena;
+  const auto& material = *arena.create<Lambertian>(Color(0.5f, 0.5f, 0.5f));
+  Pcg32 rng;
+  std::vector<Hitable*> objects;
+  objects.reserve(sphere_count);
+  for (int i = 0; i < sphere_count; ++i) {
+    const Point3f center{1000 * rng.next_float(), 1000 * rng.next_float(),
+                         1000 * rng.next_float()};
+    objects.push_back(arena.create<Sphere>(center, 0.5f, material));
+  }
+  std::printf("%-24s %10.2f ms\n", "Create primitives",
+              milliseconds_since(start));
+
+  start = steady_clock::now();
+  const auto bvh =
+      arena.create<BVH_node>(arena, objects.begin(), objects.end());
+  std::printf("%-24s %10.2f ms\n", "Build BVH", milliseconds_since(start));
+  std::printf("%-24s %10.2f MB\n", "Arena memory",
+              static_cast<double>(arena.bytes_reserved()) / (1 << 20));
+
+  auto scene = std::make_unique<Scene>(std::move(arena), *bvh);
+  start = steady_clock::now();
+  scene.reset();
+  std::printf("%-24s %10.2f ms\n", "Destroy scene",
+              milliseconds_since(start));
+
+  return 0;
+}
@@ -45,6 +45,16 @@ public:
     return true;
   }
 
+  /// Returns the surface area of the box, 0 if it is empty
+  constexpr float surface_area() const noexcept
+  {
+    const auto d = max_ - min_;
+    if (d.x < 0 || d.y < 0 || d.z < 0) {
+      return 0;
+    }
+    return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+  }
+
 private:
   Point3f min_ = {};
   Point3f max_ = {};
@@ -73,4 +83,16 @@ constexpr AABB surrounding_box(const AABB box0, const AABB box1)
                     std::max(box0.max().z, box1.max().z)}};
 }
 
+/**
+ * @brief Linearly interpolates the corners of two AABBs
+ *
+ * For an object moving linearly from box0 to box1, the result bounds it at
+ * time t.
+ */
+constexpr AABB lerp(const AABB& box0, const AABB& box1, float t)
+{
+  return AABB{lerp(box0.min(), box1.min(), t),
+              lerp(box0.max(), box1.max(), t)};
+}
+
 #endif // AABB_HPP
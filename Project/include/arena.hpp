@@ -0,0 +1,89 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A monotonic allocator for objects that live as long as a scene
+ *
+ * Memory is taken from large blocks by bumping a pointer, so objects created
+ * one after another are contiguous and creating one costs no heap allocation
+ * once a block is available. Nothing is freed before the arena itself, which
+ * releases every block at once.
+ *
+ * @warning Destructors of the objects are never called. Only objects that own
+ * no resources, such as primitives, materials and BVH nodes, may be created
+ * in an arena.
+ */
+class Arena {
+public:
+  static constexpr size_t default_block_size = 256 * 1024;
+
+  explicit Arena(size_t block_size = default_block_size) noexcept
+      : block_size_{block_size}
+  {
+  }
+
+  /// Takes the blocks of other, which is left empty and usable
+  Arena(Arena&& other) noexcept
+      : blocks_{std::exchange(other.blocks_, {})},
+        current_{std::exchange(other.current_, nullptr)},
+        remaining_{std::exchange(other.remaining_, 0)},
+        block_size_{other.block_size_},
+        bytes_used_{std::exchange(other.bytes_used_, 0)},
+        bytes_reserved_{std::exchange(other.bytes_reserved_, 0)}
+  {
+  }
+
+  /// Releases the blocks of the arena and takes those of other
+  Arena& operator=(Arena&& other) noexcept
+  {
+    if (this != &other) {
+      blocks_ = std::exchange(other.blocks_, {});
+      current_ = std::exchange(other.current_, nullptr);
+      remaining_ = std::exchange(other.remaining_, 0);
+      block_size_ = other.block_size_;
+      bytes_used_ = std::exchange(other.bytes_used_, 0);
+      bytes_reserved_ = std::exchange(other.bytes_reserved_, 0);
+    }
+    return *this;
+  }
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /**
+   * @brief Returns uninitialized memory of size bytes
+   * @pre alignment is a power of two no larger than alignof(std::max_align_t)
+   */
+  void* allocate(size_t size, size_t alignment);
+
+  /// Constructs a T in the arena
+  template <typename T, typename... Args> T* create(Args&&... args)
+  {
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "Over-aligned types are not supported");
+    return new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+
+  /// Returns the number of bytes handed out, including alignment padding
+  size_t bytes_used() const noexcept { return bytes_used_; }
+
+  /// Returns the number of bytes of all blocks
+  size_t bytes_reserved() const noexcept { return bytes_reserved_; }
+
+private:
+  std::vector<std::unique_ptr<std::byte[]>> blocks_;
+  std::byte* current_ = nullptr; // Next free byte of the last block
+  size_t remaining_ = 0;         // Free bytes after current_
+  size_t block_size_;
+  size_t bytes_used_ = 0;
+  size_t bytes_reserved_ = 0;
+};
+
+#endif // ARENA_HPP
@@ -24,7 +24,10 @@ struct Rect_XY : Hitable {
     return AABB{{min, z - 0.0001f}, {max, z + 0.0001f}};
   }
 
-  Maybe_hit_t intersect_at(const Ray& r, float t_min, float t_max) const
+  Maybe_intersection_t intersect_at(const Ray& r, float t_min,
+                                    float t_max) const noexcept override;
+
+  Hit_record surface_at(const Ray& r, const Intersection& intersection) const
       noexcept override;
 
   const Material* const material;
@@ -48,7 +51,10 @@ struct Rect_XZ : Hitable {
     return AABB{{min.x, y - 0.0001f, min.y}, {max.x, y + 0.0001f, max.y}};
   }
 
-  Maybe_hit_t intersect_at(const Ray& r, float t_min, float t_max) const
+  Maybe_intersection_t intersect_at(const Ray& r, float t_min,
+                                    float t_max) const noexcept override;
+
+  Hit_record surface_at(const Ray& r, const Intersection& intersection) const
       noexcept override;
 };
 
@@ -70,7 +76,10 @@ struct Rect_YZ : Hitable {
     return AABB{{x - 0.0001f, min.x, min.y}, {x + 0.0001f, max.x, max.y}};
   }
 
-  Maybe_hit_t intersect_at(const Ray& r, float t_min, float t_max) const
+  Maybe_intersection_t intersect_at(const Ray& r, float t_min,
+                                    float t_max) const noexcept override;
+
+  Hit_record surface_at(const Ray& r, const Intersection& intersection) const
       noexcept override;
 };
 
@@ -1,27 +1,110 @@
 #ifndef BOUNDING_VOLUME_HIERARCHY_HPP
 #define BOUNDING_VOLUME_HIERARCHY_HPP
 
-#include <memory>
 #include <vector>
 
 #include "aabb.hpp"
 #include "hitable.hpp"
 
-using Object_iterator = std::vector<std::unique_ptr<Hitable>>::iterator;
+class Arena;
+class Thread_pool;
 
+using Object_iterator = std::vector<Hitable*>::iterator;
+
+/**
+ * @brief A node of a bounding volume hierarchy
+ *
+ * Nodes do not own their children. The primitives and the nodes below the
+ * root are expected to live in the same Arena as the scene they belong to.
+ */
 class BVH_node : public Hitable {
 public:
-  BVH_node(const Object_iterator& begin, const Object_iterator& end) noexcept;
+  /**
+   * @brief Builds a tree over the objects in [begin, end), which get
+   * reordered
+   *
+   * The nodes below this one are created in arena.
+   *
+   * @pre begin != end
+   */
+  BVH_node(Arena& arena, const Object_iterator& begin,
+           const Object_iterator& end);
+
+  std::optional<AABB> bounding_box() const noexcept override
+  {
+    return surrounding_box(box0_, box1_);
+  }
 
-  std::optional<AABB> bounding_box() const noexcept override { return box_; }
+  std::optional<AABB> bounding_box_at(float time) const noexcept override
+  {
+    return is_moving_ ? lerp(box0_, box1_, time) : box0_;
+  }
 
-  Maybe_hit_t intersect_at(const Ray& r, float t_min, float t_max) const
+  Maybe_intersection_t intersect_at(const Ray& r, float t_min,
+                                    float t_max) const noexcept override;
+
+  Hit_record surface_at(const Ray& r, const Intersection& intersection) const
       noexcept override;
 
+  /**
+   * @brief Recomputes the bounds of every node after primitives moved
+   *
+   * The topology of the tree is kept. Independent subtrees are refitted in
+   * parallel on pool.
+   */
+  void refit(Thread_pool& pool);
+
+  /**
+   * @brief Expected cost of a ray query by the surface area heuristic
+   *
+   * The cost is relative to the area of the root box and measured in
+   * primitive intersections.
+   */
+  float sah_cost() const noexcept;
+
+  /// The sah_cost() of the tree right after it was built
+  float build_sah_cost() const noexcept { return build_sah_cost_; }
+
+  const Hitable* left() const noexcept { return left_; }
+
+  /// Returns the right child, null for a leaf with a single primitive
+  const Hitable* right() const noexcept { return right_; }
+
+  /// Returns the primitives at the leaves of the tree
+  std::vector<Hitable*> primitives() const;
+
 private:
-  std::unique_ptr<const Hitable> left_ = nullptr;
-  std::unique_ptr<const Hitable> right_ = nullptr;
-  AABB box_;
+  void refit_node() noexcept;
+  void refit_subtree() noexcept;
+
+  Hitable* left_ = nullptr;
+  Hitable* right_ = nullptr; ///< Null for a leaf with a single primitive
+
+  // Boxes at times 0 and 1. Rays test against their interpolation, which is
+  // tighter than a box around the whole motion.
+  AABB box0_;
+  AABB box1_;
+  bool is_moving_ = false;
+
+  // Sum of the area weighted costs of all nodes and primitives in the tree
+  float weighted_cost_ = 0;
+  float build_sah_cost_ = 0;
 };
 
+/**
+ * @brief Updates a BVH after its primitives moved
+ *
+ * Refitting is much cheaper than building, but the tree gets worse the more
+ * the primitives move away from where they were at build time. Once its SAH
+ * cost exceeds the one at build time by max_degradation, the tree is rebuilt
+ * from the same primitives, whose addresses do not change.
+ *
+ * The new nodes are created in arena. The old ones are not reclaimed before
+ * the arena is released.
+ *
+ * @return Whether the tree was rebuilt
+ */
+bool refit_or_rebuild(BVH_node*& bvh, Arena& arena, Thread_pool& pool,
+                      float max_degradation = 1.5f);
+
 #endif // BOUNDING_VOLUME_HIERARCHY_HPP
@@ -1,9 +1,15 @@
 #ifndef CAMERA_HPP
 #define CAMERA_HPP
 
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
 #include "angle.hpp"
 #include "point.hpp"
 #include "ray.hpp"
+#include "sampler.hpp"
+#include "sampling.hpp"
 #include "vector.hpp"
 
 /**
@@ -12,10 +18,60 @@
  */
 struct Camera_sample {
   Point2f film_pos;
+  float time = 0; ///< Uniform sample in [0, 1) mapped to the shutter interval
+  Point2f lens_pos{}; ///< Uniform sample in [0, 1)^2 mapped to the lens
+};
+
+/**
+ * @brief A rectangle of pixels in an image
+ */
+struct Tile_region {
+  size_t x = 0; ///< Column of the first pixel
+  size_t y = 0; ///< Row of the first pixel
+  size_t width = 0;
+  size_t height = 0;
+  size_t image_width = 0;
+  size_t image_height = 0;
+
+  size_t pixel_count() const noexcept { return width * height; }
+};
+
+/**
+ * @brief Camera rays of one sample of every pixel of a tile
+ *
+ * Rays are stored as a structure of arrays, in row-major pixel order, so they
+ * can be processed as a packet.
+ */
+struct Camera_ray_batch {
+  std::vector<float> origin_x;
+  std::vector<float> origin_y;
+  std::vector<float> origin_z;
+  std::vector<float> direction_x;
+  std::vector<float> direction_y;
+  std::vector<float> direction_z;
+  std::vector<float> time;
+
+  /// Sampler of each ray, past the numbers the camera drew from it
+  std::vector<Sampler> samplers;
+
+  size_t size() const noexcept { return time.size(); }
+
+  /// Changes the number of rays, keeping the storage if it shrinks
+  void resize(size_t size);
+
+  Ray ray(size_t i) const noexcept
+  {
+    return Ray{Point3f{origin_x[i], origin_y[i], origin_z[i]},
+               Vec3f{direction_x[i], direction_y[i], direction_z[i]},
+               time[i]};
+  }
 };
 
 class Camera {
 public:
+  /// Number of sampler dimensions generate_rays() draws for each ray
+  static constexpr std::uint64_t sample_dimensions = 5;
+
   /**
    * @brief Constructor of a camera
    * @param position The position of the camera
@@ -23,21 +79,31 @@ public:
    * @param up Direction of up
    * @param fov Field of view of the camera
    * @param aspect Aspect ratio of the screen
+   * @param shutter_open, shutter_close Times in [0, 1] between which the
+   * camera takes its rays
+   * @param aperture Diameter of the lens, 0 for a pinhole camera
+   * @param focus_distance Distance to the plane in focus
    */
-  Camera(Point3f position, Point3f lookat, Vec3f up, Radian fov,
-         float aspect) noexcept
+  Camera(Point3f position, Point3f lookat, Vec3f up, Radian fov, float aspect,
+         float shutter_open = 0, float shutter_close = 0, float aperture = 0,
+         float focus_distance = 1) noexcept
+      : lens_radius_{aperture / 2}, shutter_open_{shutter_open},
+        shutter_close_{shutter_close}
   {
     const float half_height = std::tan(fov.value() / 2);
     const float half_width = aspect * half_height;
 
     origin_ = position;
     const auto w = normalize(position - lookat);
-    const auto u = normalize(cross(up, w));
-    const auto v = cross(w, u);
+    u_ = normalize(cross(up, w));
+    v_ = cross(w, u_);
 
-    lower_left_corner_ = origin_ - half_width * u - half_height * v - w;
-    horizontal_ = 2 * half_width * u;
-    vertical_ = 2 * half_height * v;
+    // The film is placed on the plane in focus
+    lower_left_corner_ = origin_ - half_width * focus_distance * u_ -
+                         half_height * focus_distance * v_ -
+                         focus_distance * w;
+    horizontal_ = 2 * half_width * focus_distance * u_;
+    vertical_ = 2 * half_height * focus_distance * v_;
   }
 
   /**
@@ -47,15 +113,43 @@ public:
   {
     const auto u = sample.film_pos.x;
     const auto v = sample.film_pos.y;
-    return Ray{origin_,
-               lower_left_corner_ + u * horizontal_ + v * vertical_ - origin_};
+    const float time =
+        shutter_open_ + sample.time * (shutter_close_ - shutter_open_);
+
+    // Thin lens: rays leave from a point on the lens and all rays through a
+    // film position meet on the plane in focus
+    auto origin = origin_;
+    if (lens_radius_ > 0) {
+      const auto lens = concentric_sample_disk(sample.lens_pos);
+      origin += lens_radius_ * (lens.x * u_ + lens.y * v_);
+    }
+    return Ray{origin,
+               lower_left_corner_ + u * horizontal_ + v * vertical_ - origin,
+               time};
   }
 
+  /**
+   * @brief Generates the camera rays of one sample of every pixel of a tile
+   *
+   * The rays of pixel (x, y) take their random numbers from the first
+   * sample_dimensions dimensions of Sampler{seed, y * image_width + x,
+   * sample_index}. The samplers are left in out.samplers, for the paths of
+   * the rays to continue from.
+   */
+  void generate_rays(std::uint64_t seed, const Tile_region& tile,
+                     std::uint64_t sample_index,
+                     Camera_ray_batch& out) const;
+
 private:
   Point3f origin_{};
   Point3f lower_left_corner_{};
   Vec3f horizontal_{};
   Vec3f vertical_{};
+  Vec3f u_{};
+  Vec3f v_{};
+  float lens_radius_ = 0;
+  float shutter_open_ = 0;
+  float shutter_close_ = 0;
 };
 
 #endif // CAMERA_HPP
@@ -0,0 +1,119 @@
+#ifndef COMPRESSED_BVH_HPP
+#define COMPRESSED_BVH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aabb.hpp"
+#include "hitable.hpp"
+
+class Arena;
+class BVH_node;
+
+/**
+ * @brief A compact, read-only copy of a BVH for large static scenes
+ *
+ * Every node has up to four children, which are quantized to 8 bits per
+ * coordinate relative to the box of the node, in the style of compressed wide
+ * BVHs. The grid spacing of each axis is a power of two, so decoding a
+ * coordinate costs a multiply and an add. Bounds are rounded outwards, so a
+ * decoded box always contains the child.
+ *
+ * A node takes 56 bytes, against 88 bytes for each BVH_node, of which a
+ * four-wide node replaces up to three.
+ *
+ * Boxes are taken over the whole time interval, so moving primitives are
+ * supported but not culled as tightly as by a BVH_node. Refitting is not
+ * supported: build a new one from the refitted BVH_node instead.
+ */
+class Compressed_BVH : public Hitable {
+public:
+  /// Maximum number of children of a node
+  static constexpr size_t width = 4;
+
+  /**
+   * @brief Maximum number of nodes on a path from the root to a leaf
+   *
+   * It bounds the stack of the traversal, which stays on the call stack.
+   * Balanced trees stay far below it, even over billions of primitives.
+   */
+  static constexpr size_t max_depth = 42;
+
+  struct Node {
+    /// Minimum corner of the quantization grid, which is the box of the node
+    float origin[3];
+
+    /// The spacing of the grid along each axis is 2^exponent
+    std::int8_t exponent[3];
+
+    std::uint8_t child_count;
+
+    /// Quantized child bounds, indexed by [axis][child]
+    std::uint8_t lower[3][width];
+    std::uint8_t upper[3][width];
+
+    /**
+     * @brief Index of each child in the node array, or in the primitive
+     * array if leaf_bit is set
+     */
+    std::uint32_t children[width];
+  };
+
+  static constexpr std::uint32_t leaf_bit = 1u << 31;
+
+  /**
+   * @brief Compresses bvh, whose primitives must outlive the result
+   *
+   * The nodes and the primitive list are allocated in arena.
+   *
+   * @throw std::length_error if the result would be deeper than max_depth
+   */
+  Compressed_BVH(Arena& arena, const BVH_node& bvh);
+
+  /**
+   * @brief Uses nodes that were compressed before, such as ones mapped from
+   * a cache file
+   *
+   * Nothing is copied, so the nodes and the primitive list must outlive the
+   * result.
+   *
+   * @pre No path from the root is longer than max_depth nodes
+   */
+  Compressed_BVH(const AABB& box, const Node* nodes, size_t node_count,
+                 const Hitable* const* primitives,
+                 size_t primitive_count) noexcept
+      : box_{box}, nodes_{nodes}, primitives_{primitives},
+        node_count_{node_count}, primitive_count_{primitive_count}
+  {
+  }
+
+  std::optional<AABB> bounding_box() const noexcept override { return box_; }
+
+  Maybe_intersection_t intersect_at(const Ray& r, float t_min,
+                                    float t_max) const noexcept override;
+
+  Hit_record surface_at(const Ray& r, const Intersection& intersection) const
+      noexcept override;
+
+  const Node* nodes() const noexcept { return nodes_; }
+  size_t node_count() const noexcept { return node_count_; }
+
+  /// Returns the primitives in the order the leaves refer to them
+  const Hitable* const* primitives() const noexcept { return primitives_; }
+  size_t primitive_count() const noexcept { return primitive_count_; }
+
+  /// Returns the number of bytes taken by the nodes and primitive list
+  size_t memory_size() const noexcept
+  {
+    return node_count_ * sizeof(Node) + primitive_count_ * sizeof(Hitable*);
+  }
+
+private:
+  AABB box_;
+  const Node* nodes_ = nullptr;
+  const Hitable* const* primitives_ = nullptr;
+  size_t node_count_ = 0;
+  size_t primitive_count_ = 0;
+};
+
+#endif // COMPRESSED_BVH_HPP
@@ -0,0 +1,84 @@
+/**
+ * @file distributed.hpp
+ * @brief Rendering a frame with several worker processes of one machine
+ *
+ * A coordinator listens on a Unix domain socket and hands out ranges of tiles
+ * to the workers that connect to it. Every worker loads the same scene and
+ * camera, renders its range with a Path_tracer and sends the float tiles
+ * back, which the coordinator copies into the final Image.
+ *
+ * A worker that closes its connection, or does not answer within the worker
+ * timeout, is dropped and its range is handed to another worker. Tiles only
+ * depend on the seed, so the image is the same as the one Path_tracer::run
+ * renders, whichever workers rendered it.
+ *
+ * Only available on POSIX systems.
+ */
+
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "pathtracer.hpp"
+
+class Camera;
+class Image;
+class Scene;
+
+/**
+ * @brief How a coordinator distributes a frame
+ */
+struct Coordinator_settings {
+  /// Path of the socket workers connect to
+  std::string socket_path;
+
+  /**
+   * @brief Settings of the render, sent to every worker
+   *
+   * The thread count is not sent, each worker chooses its own.
+   */
+  Render_settings render;
+
+  /// Number of tiles handed to a worker at a time
+  size_t tiles_per_job = 4;
+
+  /**
+   * @brief Longest time a worker may take to render one job, and longest
+   * time the coordinator waits while no worker is connected
+   */
+  std::chrono::milliseconds worker_timeout{std::chrono::seconds{60}};
+};
+
+/**
+ * @brief Renders image with the workers that connect to settings.socket_path
+ *
+ * Returns once every tile is rendered, after telling the workers to stop.
+ *
+ * @throw std::runtime_error if the socket cannot be created, or if tiles
+ * remain and no worker was connected for settings.worker_timeout
+ * @throw std::invalid_argument if settings.render.tile_size is 0
+ */
+void run_coordinator(const Coordinator_settings& settings, Image& image,
+                     size_t sample_per_pixel);
+
+/**
+ * @brief Renders the jobs a coordinator sends until it tells it to stop
+ *
+ * Connection attempts are repeated until connect_timeout elapses, so a worker
+ * may start before its coordinator.
+ *
+ * @param thread_count Number of threads of the worker, 0 means one per
+ * hardware thread
+ * @return Whether the coordinator told the worker to stop, rather than
+ * closing the connection
+ * @throw std::runtime_error if no coordinator listens at socket_path
+ */
+bool run_worker(const std::string& socket_path, const Scene& scene,
+                const Camera& camera, size_t thread_count = 0,
+                std::chrono::milliseconds connect_timeout =
+                    std::chrono::seconds{10});
+
+#endif // DISTRIBUTED_HPP
@@ -0,0 +1,200 @@
+#ifndef FILM_HPP
+#define FILM_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "color.hpp"
+
+class Image;
+
+/**
+ * @brief Sum of radiance samples in 64 bit fixed point
+ *
+ * Integer addition is associative, so a sum does not depend on how its
+ * samples were grouped. Renders of different sample ranges of a pixel
+ * therefore add up to exactly the sum a single render of all of them takes.
+ *
+ * Components are quantized to steps of 2^-24 and clamped to [0, 2^24], so a
+ * sum holds at least 2^15 samples of the largest value. NaN samples count as
+ * black.
+ */
+class Radiance_sum {
+public:
+  constexpr Radiance_sum() noexcept = default;
+
+  /// Quantizes sample and adds it
+  Radiance_sum& operator+=(const Color& sample) noexcept
+  {
+    r_ += quantize(sample.r);
+    g_ += quantize(sample.g);
+    b_ += quantize(sample.b);
+    return *this;
+  }
+
+  constexpr Radiance_sum& operator+=(const Radiance_sum& rhs) noexcept
+  {
+    r_ += rhs.r_;
+    g_ += rhs.g_;
+    b_ += rhs.b_;
+    return *this;
+  }
+
+  /// Returns the sum divided by divisor
+  Color divided_by(double divisor) const noexcept
+  {
+    const auto scale = 1 / (one * divisor);
+    return Color(static_cast<float>(r_ * scale),
+                 static_cast<float>(g_ * scale),
+                 static_cast<float>(b_ * scale));
+  }
+
+  Color value() const noexcept { return divided_by(1); }
+
+  friend constexpr bool operator==(const Radiance_sum& lhs,
+                                   const Radiance_sum& rhs) noexcept
+  {
+    return lhs.r_ == rhs.r_ && lhs.g_ == rhs.g_ && lhs.b_ == rhs.b_;
+  }
+
+private:
+  static constexpr double one = 1 << 24;
+
+  static std::int64_t quantize(float value) noexcept
+  {
+    // Written so that NaN fails the comparison
+    if (!(value > 0)) {
+      return 0;
+    }
+    return std::llround(std::min(static_cast<double>(value), one) * one);
+  }
+
+  std::int64_t r_ = 0;
+  std::int64_t g_ = 0;
+  std::int64_t b_ = 0;
+};
+
+/**
+ * @brief Accumulation buffer of a render in progress
+ *
+ * Film keeps the sum of all radiance samples and the number of samples taken
+ * for every pixel, so a render can be continued later by adding more samples.
+ *
+ * The samples of a pixel are the consecutive sample indices starting at
+ * first_sample(). A frame can be split into films of disjoint sample ranges
+ * that are rendered separately, then merged into the same film a single
+ * render of all the samples produces.
+ */
+class Film {
+public:
+  /**
+   * @brief Creates an empty film
+   * @param seed Seed of the random sequences the samples are drawn from
+   * @param first_sample Index of the first sample of every pixel
+   */
+  Film(size_t width, size_t height, std::uint64_t seed = 0,
+       std::uint32_t first_sample = 0);
+
+  size_t width() const { return width_; }
+  size_t height() const { return height_; }
+
+  /**
+   * @brief Seed of the random sequences the accumulated samples were drawn
+   * from
+   *
+   * Continuing a render with the same seed continues the same sequences.
+   */
+  std::uint64_t seed() const { return seed_; }
+
+  /// Index of the first sample of every pixel
+  std::uint32_t first_sample() const { return first_sample_; }
+
+  /**
+   * @brief Adds count samples whose radiance sums to sum to the pixel (x, y)
+   *
+   * Different pixels can be updated from different threads at the same time.
+   */
+  void add_samples(size_t x, size_t y, const Radiance_sum& sum,
+                   std::uint32_t count)
+  {
+    assert(x < width_ && y < height_);
+    sums_[y * width_ + x] += sum;
+    sample_counts_[y * width_ + x] += count;
+  }
+
+  /// Adds count samples whose radiance sums to sum to the pixel (x, y)
+  void add_samples(size_t x, size_t y, Color sum, std::uint32_t count)
+  {
+    Radiance_sum quantized;
+    quantized += sum;
+    add_samples(x, y, quantized, count);
+  }
+
+  /// Returns the sum of all samples of pixel (x, y)
+  const Radiance_sum& sum_at(size_t x, size_t y) const
+  {
+    assert(x < width_ && y < height_);
+    return sums_[y * width_ + x];
+  }
+
+  /// Returns the number of samples taken for pixel (x, y)
+  std::uint32_t sample_count_at(size_t x, size_t y) const
+  {
+    assert(x < width_ && y < height_);
+    return sample_counts_[y * width_ + x];
+  }
+
+  /// Returns the smallest number of samples taken by any pixel
+  std::uint32_t min_sample_count() const;
+
+  /**
+   * @brief Adds the samples of other, which continue the samples of this
+   * film
+   *
+   * For every pixel of other that has samples, its first sample must follow
+   * the last sample of the same pixel in this film. Films of a frame split by
+   * sample range are merged in the order of their ranges.
+   *
+   * @throw std::invalid_argument if other has another size or seed, or its
+   * samples do not continue the ones of this film
+   */
+  void merge(const Film& other);
+
+  /**
+   * @brief Writes the average of the samples of every pixel to image
+   * @pre image has the same size as the film
+   */
+  void develop(Image& image) const;
+
+  /**
+   * @brief Saves the film into a compact binary file
+   *
+   * The data is written to a temporary file first and then renamed, so an
+   * interrupted save never destroys a previous file.
+   *
+   * @throw Cannot_write_file if the file cannot be written
+   */
+  void save(const std::string& filename) const;
+
+  /**
+   * @brief Loads a film saved by save()
+   * @throw std::runtime_error if the file is missing, not a film, or not the
+   * size its header announces
+   */
+  static Film load(const std::string& filename);
+
+private:
+  size_t width_;
+  size_t height_;
+  std::uint64_t seed_;
+  std::uint32_t first_sample_;
+  std::vector<Radiance_sum> sums_;
+  std::vector<std::uint32_t> sample_counts_;
+};
+
+#endif // FILM_HPP
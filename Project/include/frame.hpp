@@ -0,0 +1,52 @@
+#ifndef FRAME_HPP
+#define FRAME_HPP
+
+#include <cmath>
+
+#include "vector.hpp"
+
+/** \addtogroup math
+ *  @{
+ */
+
+/**
+ * @brief Orthonormal basis used to express directions relative to a surface
+ *
+ * In local coordinates the normal is +z, so the cosine of the angle between
+ * a direction and the normal is simply its z component.
+ */
+struct Frame {
+  Vec3f s; ///< First tangent
+  Vec3f t; ///< Second tangent
+  Vec3f n; ///< Normal
+
+  /**
+   * @brief Builds a frame around the unit vector n
+   *
+   * Credit: Duff et al. 2017, Building an Orthonormal Basis, Revisited
+   */
+  static Frame from_normal(Vec3f n) noexcept
+  {
+    const float sign = std::copysign(1.0f, n.z);
+    const float a = -1 / (sign + n.z);
+    const float b = n.x * n.y * a;
+    return Frame{Vec3f{1 + sign * n.x * n.x * a, sign * b, -sign * n.x},
+                 Vec3f{b, sign + n.y * n.y * a, -n.y}, n};
+  }
+
+  /// Expresses the world space vector v in this frame
+  constexpr Vec3f to_local(Vec3f v) const noexcept
+  {
+    return Vec3f{dot(v, s), dot(v, t), dot(v, n)};
+  }
+
+  /// Expresses the vector v given in this frame in world space
+  constexpr Vec3f to_world(Vec3f v) const noexcept
+  {
+    return s * v.x + t * v.y + n * v.z;
+  }
+};
+
+/** @}*/ // math group
+
+#endif // FRAME_HPP
@@ -8,15 +8,58 @@
 
 struct Ray;
 class Material;
+struct Hitable;
 
 /**
- * @brief Data recorded for a ray-object intersection
+ * @brief Minimal record of a ray-object intersection found during traversal
+ *
+ * It only holds what is needed to compare hits and to later compute the
+ * surface data of the closest one with Hitable::surface_at.
+ */
+struct Intersection {
+  float t{};
+  const Hitable* object{}; ///< The primitive that was hit
+
+  /// Primitive specific coordinates of the hit, such as barycentrics
+  Point2f coordinates{};
+
+  /// The instance the primitive was hit through, if any
+  const Hitable* instance{};
+
+  /// Returns the object whose surface_at computes the surface data
+  const Hitable& surface_owner() const noexcept
+  {
+    return instance ? *instance : *object;
+  }
+};
+
+using Maybe_intersection_t = std::optional<Intersection>;
+
+/**
+ * @brief Surface data at the closest ray-object intersection
  */
 struct Hit_record {
   float t{};
   Point3f point{}; ///< Intersection point
-  Vec3f normal{};  ///< Surface normal, need to be construct as a unit vector
+
+  /**
+   * @brief Unit surface normal
+   *
+   * No primitive perturbs its normal, so this is both the geometric and the
+   * shading normal.
+   */
+  Vec3f normal{};
   const Material* const material{};
+  Point2f uv{}; ///< Surface coordinates of the intersection point
+
+  /**
+   * @brief Approximate width in uv space of the surface region this hit
+   * stands for, used to pick the mip level of image textures
+   */
+  float uv_footprint{};
+
+  Vec3f dpdu{}; ///< Derivative of the point along u, tangent to the surface
+  Vec3f dpdv{}; ///< Derivative of the point along v, tangent to the surface
 };
 
 using Maybe_hit_t = std::optional<Hit_record>;
@@ -25,17 +68,44 @@ struct Hitable {
   virtual ~Hitable() = default;
 
   /**
-   * @brief Get the bounding box of an object
+   * @brief Get the bounding box of an object over the whole time interval
    * @return An AABB for objects with bounding_box, nothing otherwise (for
    * example, infinite plane)
    */
   virtual std::optional<AABB> bounding_box() const noexcept = 0;
 
+  /**
+   * @brief Get the bounding box of an object at a time in [0, 1]
+   *
+   * Moving objects must lie inside the linear interpolation of their boxes at
+   * times 0 and 1, which is all a BVH_node stores of them. Static objects
+   * return bounding_box().
+   */
+  virtual std::optional<AABB> bounding_box_at(float /*time*/) const noexcept
+  {
+    return bounding_box();
+  }
+
   /**
    * @brief Ray-object intersection detection
-   * @return A optional record of intersection information, nothing if not hit
+   *
+   * Only computes what is needed to find the closest hit. Call surface_at on
+   * the surface_owner of the result for the rest.
+   *
+   * @return The intersection closest to the ray origin in [t_min, t_max],
+   * nothing if not hit
+   */
+  virtual Maybe_intersection_t intersect_at(const Ray& r, float t_min,
+                                            float t_max) const noexcept = 0;
+
+  /**
+   * @brief Computes the surface data of an intersection of r with this
+   * primitive
+   * @pre intersection was returned by intersect_at for r and its
+   * surface_owner is this
    */
-  virtual Maybe_hit_t intersect_at(const Ray& r, float t_min, float t_max) const
+  virtual Hit_record surface_at(const Ray& r,
+                                const Intersection& intersection) const
       noexcept = 0;
 };
 
@@ -1,13 +1,17 @@
 #ifndef IMAGE_HPP
 #define IMAGE_HPP
 
-#include <sstream>
+#include <cassert>
+#include <cstdint>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "color.hpp"
 
+class Thread_pool;
+struct Tile;
+
 struct Unsupported_image_extension : public std::invalid_argument {
   explicit Unsupported_image_extension(const char* filename)
       : std::invalid_argument{filename}
@@ -34,6 +38,9 @@ public:
    */
   void saveto(const std::string& filename) const;
 
+  /// Same as saveto(filename), converting the pixels on the workers of pool
+  void saveto(const std::string& filename, Thread_pool& pool) const;
+
   size_t width() const { return width_; }
 
   size_t height() const { return height_; }
@@ -50,18 +57,70 @@ public:
     return data_[y * width_ + x];
   }
 
+  /**
+   * @brief Returns the width() pixels of row y, without bounds checking
+   *
+   * Rows follow each other in memory, so row(y) + width() is row(y + 1).
+   */
+  Color* row(size_t y) noexcept
+  {
+    assert(y < height_);
+    return data_.data() + y * width_;
+  }
+
+  const Color* row(size_t y) const noexcept
+  {
+    assert(y < height_);
+    return data_.data() + y * width_;
+  }
+
+  /**
+   * @brief Copies the pixels of tile to its place in the image
+   * @pre tile lies inside the image
+   */
+  void blit(const Tile& tile) noexcept;
+
+  /// Multiplies every pixel by factor
+  void scale(float factor) noexcept;
+
+  /**
+   * @brief Adds the pixels of other to the pixels of the image
+   * @throw std::invalid_argument if the images differ in size
+   */
+  Image& operator+=(const Image& other);
+
+  /// Raises every component to the power 1 / gamma, negatives become 0
+  void apply_gamma(float gamma) noexcept;
+
+  /// Maps every component c to c / (1 + c), which brings it below 1
+  void tonemap() noexcept;
+
+  /**
+   * @brief Returns the 8-bit RGB pixels saveto writes
+   *
+   * Components are clamped to [0, 1] and gamma 2 encoded. The conversion is
+   * vectorized where the processor allows it.
+   */
+  std::vector<std::uint8_t> to_rgb8() const;
+
+  /// Same as to_rgb8(), converting bands of rows on the workers of pool
+  std::vector<std::uint8_t> to_rgb8(Thread_pool& pool) const;
+
 private:
   void bound_checking(size_t x, size_t y) const
   {
     if (x >= width_ || y >= height_) {
-      std::stringstream ss;
-      ss << "Access image out of index:\n";
-      ss << "Input x:" << x << " y:" << y << "\n";
-      ss << "width:" << width_ << " height:" << height_ << "\n";
-      throw std::out_of_range{ss.str().c_str()};
+      throw_out_of_range(x, y);
     }
   }
 
+  // Out of line, so the checked accessors stay small enough to inline
+  [[noreturn]] void throw_out_of_range(size_t x, size_t y) const;
+
+  // Converts the rows [first_row, last_row) into their place in rgb
+  void convert_rows(std::uint8_t* rgb, size_t first_row,
+                    size_t last_row) const;
+
   size_t width_;
   size_t height_;
   std::vector<Color> data_;
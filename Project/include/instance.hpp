@@ -0,0 +1,70 @@
+#ifndef INSTANCE_HPP
+#define INSTANCE_HPP
+
+#include <optional>
+
+#include "hitable.hpp"
+#include "transform.hpp"
+
+/**
+ * @brief A placement of shared geometry in the scene
+ *
+ * The geometry, usually a BVH_node over the primitives of one model, is given
+ * in its own object space and may be shared by any number of instances. It
+ * is not owned by the instances and must outlive them. Rays
+ * are transformed into object space when they reach an instance, so the
+ * geometry is stored once however often it appears. Putting the instances in
+ * a BVH_node of their own gives a two-level hierarchy.
+ *
+ * @warning Instances do not nest: the geometry must not contain instances.
+ */
+class Instance : public Hitable {
+public:
+  /**
+   * @param object Geometry in object space
+   * @param object_to_world Placement of the geometry in the scene
+   */
+  Instance(const Hitable& object,
+           const Transform& object_to_world) noexcept;
+
+  /**
+   * @brief Constructs an instance moving from start at time 0 to end at
+   * time 1
+   *
+   * The matrices of the two transforms are interpolated linearly, which
+   * suits translations and small rotations.
+   */
+  Instance(const Hitable& object, const Transform& start,
+           const Transform& end) noexcept;
+
+  /**
+   * @brief Moves the instance
+   *
+   * A BVH containing the instance must be refitted afterwards.
+   */
+  void set_transform(const Transform& object_to_world) noexcept;
+
+  /// Moves the instance, with its motion over the time interval
+  void set_transform(const Transform& start, const Transform& end) noexcept;
+
+  std::optional<AABB> bounding_box() const noexcept override;
+  std::optional<AABB> bounding_box_at(float time) const noexcept override;
+
+  Maybe_intersection_t intersect_at(const Ray& r, float t_min,
+                                    float t_max) const noexcept override;
+
+  Hit_record surface_at(const Ray& r, const Intersection& intersection) const
+      noexcept override;
+
+private:
+  Transform to_world_at(float time) const noexcept;
+
+  const Hitable* object_;
+  Transform start_;
+  Transform end_;
+  bool is_moving_ = false;
+  std::optional<AABB> box0_;
+  std::optional<AABB> box1_;
+};
+
+#endif // INSTANCE_HPP
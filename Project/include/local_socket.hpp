@@ -0,0 +1,73 @@
+#ifndef LOCAL_SOCKET_HPP
+#define LOCAL_SOCKET_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief A Unix domain stream socket between processes of one machine
+ *
+ * Only available on POSIX systems.
+ */
+class Local_socket {
+public:
+  /// Constructs a closed socket
+  Local_socket() noexcept = default;
+
+  ~Local_socket();
+
+  Local_socket(Local_socket&& other) noexcept;
+  Local_socket& operator=(Local_socket&& other) noexcept;
+  Local_socket(const Local_socket&) = delete;
+  Local_socket& operator=(const Local_socket&) = delete;
+
+  /**
+   * @brief Creates a socket that accepts connections at path
+   *
+   * A file left at path by a previous server is replaced.
+   *
+   * @throw std::runtime_error if the socket cannot be created
+   */
+  static Local_socket listen(const std::string& path);
+
+  /**
+   * @brief Connects to a socket created by listen
+   * @throw std::runtime_error if no server listens at path
+   */
+  static Local_socket connect(const std::string& path);
+
+  /**
+   * @brief Waits up to timeout for a connection to a listening socket
+   * @return The connection, or a closed socket if none arrived in time
+   */
+  Local_socket accept(std::chrono::milliseconds timeout) const;
+
+  bool is_open() const noexcept { return fd_ >= 0; }
+
+  /// Fails the receives that wait longer than timeout, 0 waits forever
+  void set_receive_timeout(std::chrono::milliseconds timeout) const noexcept;
+
+  /// Returns whether all size bytes were sent
+  bool send_all(const void* data, size_t size) const noexcept;
+
+  /// Returns whether size bytes were received before an error or timeout
+  bool receive_all(void* data, size_t size) const noexcept;
+
+  template <typename T> bool send_value(const T& value) const noexcept
+  {
+    return send_all(&value, sizeof(value));
+  }
+
+  template <typename T> bool receive_value(T& value) const noexcept
+  {
+    return receive_all(&value, sizeof(value));
+  }
+
+private:
+  explicit Local_socket(int fd) noexcept : fd_{fd} {}
+
+  int fd_ = -1;
+};
+
+#endif // LOCAL_SOCKET_HPP
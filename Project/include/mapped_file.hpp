@@ -0,0 +1,42 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief A read-only memory mapping of a whole file
+ *
+ * Pages are read from disk when they are first touched, so opening a large
+ * file costs almost nothing. Uses mmap on POSIX systems and file mappings on
+ * Windows.
+ */
+class Mapped_file {
+public:
+  /// Constructs an empty mapping
+  Mapped_file() noexcept = default;
+
+  /**
+   * @brief Maps filename into memory
+   * @throw std::runtime_error if the file cannot be opened or mapped
+   */
+  explicit Mapped_file(const std::string& filename);
+
+  ~Mapped_file();
+
+  Mapped_file(Mapped_file&& other) noexcept;
+  Mapped_file& operator=(Mapped_file&& other) noexcept;
+  Mapped_file(const Mapped_file&) = delete;
+  Mapped_file& operator=(const Mapped_file&) = delete;
+
+  const std::byte* data() const noexcept { return data_; }
+  size_t size() const noexcept { return size_; }
+
+private:
+  void unmap() noexcept;
+
+  const std::byte* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+#endif // MAPPED_FILE_HPP
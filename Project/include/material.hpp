@@ -7,37 +7,104 @@
 #include "angle.hpp"
 #include "color.hpp"
 #include "hitable.hpp"
+#include "microfacet.hpp"
 #include "ray.hpp"
+#include "texture.hpp"
 
+class Sampler;
+
+/**
+ * @brief A direction sampled from a BSDF along with its value and density
+ *
+ * The contribution of the sample to a path is f * |cos(theta_i)| / pdf.
+ */
+struct Bsdf_sample {
+  Vec3f wi{};  ///< Sampled unit direction leaving the surface
+  Color f{};   ///< Value of the BSDF for (wo, wi)
+  float pdf{}; ///< Solid angle density of sampling wi
+
+  /**
+   * @brief Whether wi was chosen by a delta distribution (perfect mirror or
+   * refraction)
+   *
+   * Such directions are never returned by eval() or pdf(). By convention f
+   * holds the reflectance divided by |cos(theta_i)| and pdf is 1.
+   */
+  bool is_specular = false;
+};
+
+/**
+ * @brief The scattering function of a surface
+ *
+ * All directions point away from the surface: wo towards where the light
+ * goes (the viewer), wi towards where it comes from.
+ */
 class Material {
 public:
   Material() noexcept = default;
   explicit Material(Color albedo) noexcept : albedo_{albedo} {}
+
+  /// Creates a material whose albedo varies over the surface
+  explicit Material(const Texture& albedo) noexcept : texture_{&albedo} {}
   virtual ~Material() = default;
 
   /**
-   * @brief scatter
-   * @param ray_in Incident ray
-   * @param record
-   * @return scattered ray if the incident ray is not absorbed
+   * @brief Importance samples an incident direction
+   * @param wo Unit direction towards the viewer
+   * @param record Surface the ray hit
+   * @param sampler Source of every random decision made by the material
+   * @return nothing if the light is absorbed
    */
-  virtual std::optional<Ray> scatter(const Ray& ray_in,
-                                     const Hit_record& record) const = 0;
+  virtual std::optional<Bsdf_sample>
+  sample(Vec3f wo, const Hit_record& record, Sampler& sampler) const = 0;
+
+  /**
+   * @brief Evaluates the non-specular part of the BSDF for a pair of
+   * directions
+   */
+  virtual Color eval(Vec3f /*wo*/, Vec3f /*wi*/,
+                     const Hit_record& /*record*/) const
+  {
+    return Color{};
+  }
+
+  /**
+   * @brief Solid angle density with which sample() returns wi for wo,
+   * ignoring specular directions
+   */
+  virtual float pdf(Vec3f /*wo*/, Vec3f /*wi*/,
+                    const Hit_record& /*record*/) const
+  {
+    return 0;
+  }
 
   virtual Color emitted() const { return Color{}; }
 
-  constexpr Color albedo() const noexcept { return albedo_; }
+  /// Returns the albedo of the material at a hit point
+  Color albedo(const Hit_record& record) const
+  {
+    return texture_ ? texture_->value(record) : albedo_;
+  }
 
 private:
   Color albedo_{0.5f, 0.5f, 0.5f};
+  const Texture* texture_ = nullptr;
 };
 
+/**
+ * @brief Ideal diffuse reflector, sampled with a cosine-weighted distribution
+ *
+ * The surface is two-sided: it reflects on whichever side it is seen from.
+ */
 class Lambertian : public Material {
 public:
   explicit Lambertian(Color albedo) noexcept : Material{albedo} {}
+  explicit Lambertian(const Texture& albedo) noexcept : Material{albedo} {}
 
-  std::optional<Ray> scatter(const Ray& ray_in,
-                             const Hit_record& record) const override;
+  std::optional<Bsdf_sample> sample(Vec3f wo, const Hit_record& record,
+                                    Sampler& sampler) const override;
+  Color eval(Vec3f wo, Vec3f wi, const Hit_record& record) const override;
+  float pdf(Vec3f wo, Vec3f wi, const Hit_record& record) const override;
 };
 
 class Metal : public Material {
@@ -47,8 +114,8 @@ public:
   {
   }
 
-  std::optional<Ray> scatter(const Ray& ray_in,
-                             const Hit_record& record) const override;
+  std::optional<Bsdf_sample> sample(Vec3f wo, const Hit_record& record,
+                                    Sampler& sampler) const override;
 
 private:
   float fuzzness_;
@@ -62,20 +129,80 @@ public:
   {
   }
 
-  std::optional<Ray> scatter(const Ray& ray_in,
-                             const Hit_record& record) const override;
+  std::optional<Bsdf_sample> sample(Vec3f wo, const Hit_record& record,
+                                    Sampler& sampler) const override;
 
 private:
   float fuzzness_;
   float refractive_index_;
 };
 
+/**
+ * @brief Rough metal modelled by a GGX microfacet BRDF
+ *
+ * The albedo is the reflectance at normal incidence, Schlick's approximation
+ * gives the reflectance at other angles. Directions are importance sampled
+ * from the visible normals, so no sample is wasted below the surface.
+ */
+class Conductor : public Material {
+public:
+  /**
+   * @param reflectance Reflectance at normal incidence
+   * @param roughness Perceptual roughness in [0, 1]
+   */
+  Conductor(Color reflectance, float roughness) noexcept
+      : Material{reflectance}, distribution_{roughness}
+  {
+  }
+
+  std::optional<Bsdf_sample> sample(Vec3f wo, const Hit_record& record,
+                                    Sampler& sampler) const override;
+  Color eval(Vec3f wo, Vec3f wi, const Hit_record& record) const override;
+  float pdf(Vec3f wo, Vec3f wi, const Hit_record& record) const override;
+
+private:
+  Ggx distribution_;
+};
+
+/**
+ * @brief Rough glass modelled by a GGX microfacet BSDF
+ *
+ * Reflection and refraction through the microfacets follow Walter et al.
+ * 2007, Microfacet Models for Refraction through Rough Surfaces. The normal of
+ * the hit record must point to the outside.
+ */
+class Rough_dielectric : public Material {
+public:
+  /**
+   * @param tint Color multiplied into every scattering event
+   * @param roughness Perceptual roughness in [0, 1]
+   * @param refractive_index Refractive index of the inside
+   */
+  Rough_dielectric(Color tint, float roughness,
+                   float refractive_index) noexcept
+      : Material{tint}, distribution_{roughness}, refractive_index_{
+                                                      refractive_index}
+  {
+  }
+
+  std::optional<Bsdf_sample> sample(Vec3f wo, const Hit_record& record,
+                                    Sampler& sampler) const override;
+  Color eval(Vec3f wo, Vec3f wi, const Hit_record& record) const override;
+  float pdf(Vec3f wo, Vec3f wi, const Hit_record& record) const override;
+
+private:
+  Bsdf_sample evaluate(Vec3f wo, Vec3f wi, Color tint) const noexcept;
+
+  Ggx distribution_;
+  float refractive_index_;
+};
+
 class Emission : public Material {
 public:
   explicit Emission(Color emit) noexcept : emit_(emit) {}
 
-  std::optional<Ray> scatter(const Ray& ray_in,
-                             const Hit_record& record) const override;
+  std::optional<Bsdf_sample> sample(Vec3f wo, const Hit_record& record,
+                                    Sampler& sampler) const override;
   Color emitted() const override;
 
 private:
@@ -0,0 +1,141 @@
+/**
+ * @file microfacet.hpp
+ * @brief The GGX (Trowbridge-Reitz) microfacet distribution
+ *
+ * All directions are given in a local shading frame whose normal is +z.
+ */
+
+#ifndef MICROFACET_HPP
+#define MICROFACET_HPP
+
+#include <algorithm>
+#include <cmath>
+
+#include "angle.hpp"
+#include "point.hpp"
+#include "vector.hpp"
+
+/** \addtogroup math
+ *  @{
+ */
+
+/**
+ * @brief Isotropic GGX distribution of microfacet normals
+ */
+class Ggx {
+public:
+  /**
+   * @brief Creates a distribution from a perceptual roughness in [0, 1]
+   *
+   * The GGX width is the square of the roughness, which makes roughness look
+   * roughly linear. Very small widths are clamped to keep the distribution
+   * finite.
+   */
+  explicit Ggx(float roughness) noexcept
+      : alpha_{std::max(roughness * roughness, 1e-3f)}
+  {
+  }
+
+  float alpha() const noexcept { return alpha_; }
+
+  /// Density of microfacet normals m, projected onto the macro surface
+  float d(Vec3f m) const noexcept
+  {
+    if (m.z <= 0) {
+      return 0;
+    }
+    const float cos2 = m.z * m.z;
+    const float tan2 = (1 - cos2) / cos2;
+    const float e = 1 + tan2 / (alpha_ * alpha_);
+    return 1 / (pi * alpha_ * alpha_ * cos2 * cos2 * e * e);
+  }
+
+  /// Smith's auxiliary function, the ratio of hidden to visible area
+  float lambda(Vec3f w) const noexcept
+  {
+    const float cos2 = w.z * w.z;
+    if (cos2 == 0) {
+      return 0;
+    }
+    const float tan2 = std::max(0.f, 1 - cos2) / cos2;
+    return (std::sqrt(1 + alpha_ * alpha_ * tan2) - 1) / 2;
+  }
+
+  /// Fraction of microfacets visible from w
+  float g1(Vec3f w) const noexcept { return 1 / (1 + lambda(w)); }
+
+  /// Fraction of microfacets visible from both wo and wi
+  float g(Vec3f wo, Vec3f wi) const noexcept
+  {
+    return 1 / (1 + lambda(wo) + lambda(wi));
+  }
+
+  /// Density of the normals visible from w that sample_visible() follows
+  float visible_pdf(Vec3f w, Vec3f m) const noexcept
+  {
+    return g1(w) / std::abs(w.z) * d(m) * std::abs(dot(w, m));
+  }
+
+  /**
+   * @brief Samples a microfacet normal visible from w
+   *
+   * Credit: Heitz 2018, Sampling the GGX Distribution of Visible Normals
+   */
+  Vec3f sample_visible(Vec3f w, Point2f u) const noexcept
+  {
+    // Stretch the view direction so the distribution becomes a hemisphere
+    auto wh = normalize(Vec3f{alpha_ * w.x, alpha_ * w.y, w.z});
+    if (wh.z < 0) {
+      wh = -wh;
+    }
+    const auto t1 = wh.z < 0.99999f ? normalize(cross(Vec3f{0, 0, 1}, wh))
+                                    : Vec3f{1, 0, 0};
+    const auto t2 = cross(wh, t1);
+
+    // Uniform point on the disk, warped to the visible half of it
+    const float r = std::sqrt(u.x);
+    const float phi = 2 * pi * u.y;
+    const float px = r * std::cos(phi);
+    const float h = std::sqrt(1 - px * px);
+    const float s = (1 + wh.z) / 2;
+    const float py = (1 - s) * h + s * r * std::sin(phi);
+    const float pz = std::sqrt(std::max(0.f, 1 - px * px - py * py));
+
+    // Project back onto the hemisphere and unstretch
+    const auto nh = px * t1 + py * t2 + pz * wh;
+    return normalize(
+        Vec3f{alpha_ * nh.x, alpha_ * nh.y, std::max(1e-6f, nh.z)});
+  }
+
+private:
+  float alpha_;
+};
+
+/**
+ * @brief Fresnel reflectance of a smooth dielectric boundary
+ * @param cos_theta_i Cosine of the incident angle, negative from inside
+ * @param eta Refractive index of the inside over that of the outside
+ */
+inline float fresnel_dielectric(float cos_theta_i, float eta) noexcept
+{
+  if (cos_theta_i < 0) {
+    eta = 1 / eta;
+    cos_theta_i = -cos_theta_i;
+  }
+
+  const float sin2_theta_t = (1 - cos_theta_i * cos_theta_i) / (eta * eta);
+  if (sin2_theta_t >= 1) {
+    return 1; // total internal reflection
+  }
+  const float cos_theta_t = std::sqrt(1 - sin2_theta_t);
+
+  const float parallel =
+      (eta * cos_theta_i - cos_theta_t) / (eta * cos_theta_i + cos_theta_t);
+  const float perpendicular =
+      (cos_theta_i - eta * cos_theta_t) / (cos_theta_i + eta * cos_theta_t);
+  return (parallel * parallel + perpendicular * perpendicular) / 2;
+}
+
+/** @}*/ // math group
+
+#endif // MICROFACET_HPP
@@ -1,27 +1,272 @@
 #ifndef PATHTRACER_HPP
 #define PATHTRACER_HPP
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
-#include <random>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 class Camera;
 class Scene;
 class Image;
+class Film;
+class Tiled_image_writer;
 struct Ray;
 struct Color;
+struct Tile;
 
-#include <indicators/progress_bar.hpp>
+#include "thread_pool.hpp"
+#include "tile_schedule.hpp"
+
+/// Clock of the deadlines of renders
+using Render_clock = std::chrono::steady_clock;
+
+/**
+ * @brief Where and how often a progressive render saves its Film
+ */
+struct Checkpoint_settings {
+  /// File the film is saved to, checkpointing is disabled if it is empty
+  std::string filename;
+
+  /// Minimum wall-clock time between two checkpoints
+  std::chrono::seconds interval{60};
+};
+
+/**
+ * @brief Settings that stay the same for every frame a Path_tracer renders
+ */
+struct Render_settings {
+  /**
+   * @brief Seed of every random decision of a render
+   *
+   * Renders with the same seed are bit-identical, whatever the number of
+   * threads. Renders into a Film use the seed of the film instead.
+   */
+  std::uint64_t seed = 0;
+
+  /// Number of worker threads, 0 means one per hardware thread
+  size_t thread_count = 0;
+
+  /**
+   * @brief Width and height in pixels of the tiles a frame is split into
+   *
+   * Tiles are the unit of work of the threads, so smaller tiles balance the
+   * load better and larger ones keep more of the scene in cache. The image
+   * does not depend on it.
+   */
+  size_t tile_size = 32;
+
+  /// Number of bounces after which a path is terminated
+  size_t max_depth = 100;
+
+  /**
+   * @brief Order in which the tiles are rendered
+   *
+   * Renders on the thread pool also split the last tiles of a frame into
+   * smaller ones while fewer tiles than threads remain, see Tile_queue.
+   */
+  Tile_order tile_order = Tile_order::hilbert;
+};
+
+/**
+ * @brief Lets another thread stop the renders that share it
+ *
+ * Copies share their state: the owner of a job keeps a copy and cancels it,
+ * the Path_tracer checks its own copy before every tile and every pass.
+ */
+class Cancellation_token {
+public:
+  Cancellation_token() : cancelled_{std::make_shared<std::atomic<bool>>()} {}
+
+  /// Safe to call from any thread, at any time
+  void cancel() const noexcept { cancelled_->store(true); }
+
+  bool is_cancelled() const noexcept { return cancelled_->load(); }
+
+private:
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+/// Thrown by a render whose cancellation token was cancelled
+struct Render_cancelled : public std::runtime_error {
+  Render_cancelled() : std::runtime_error{"Render cancelled"} {}
+};
+
+/**
+ * @brief How far a render has come, passed to the progress callback
+ */
+struct Render_progress {
+  /// Tiles finished, over all passes
+  size_t tiles_done = 0;
+
+  /// Samples taken, over all pixels
+  size_t samples_done = 0;
+
+  /**
+   * @brief Part of the render that is done, from 0 to 1
+   *
+   * A render against a deadline counts the elapsed part of its time budget
+   * when it is ahead of the samples.
+   */
+  float fraction = 0;
+
+  std::chrono::duration<double> elapsed{};
+
+  /// Time until the render ends, extrapolated from elapsed and fraction
+  std::chrono::duration<double> remaining() const
+  {
+    return fraction > 0 ? elapsed * ((1 - fraction) / fraction)
+                        : std::chrono::duration<double>::max();
+  }
+};
+
+using Progress_callback = std::function<void(const Render_progress&)>;
+
+/**
+ * @brief One view of a scene to render: a camera, the image it renders into
+ * and its number of samples per pixel
+ */
+struct Render_job {
+  const Camera& camera;
+  Image& image;
+  size_t sample_per_pixel;
+};
 
 class Path_tracer {
 
 public:
-  Path_tracer();
+  /// @throw std::invalid_argument if settings.tile_size is 0
+  explicit Path_tracer(const Render_settings& settings = {});
+
+  const Render_settings& settings() const noexcept { return settings_; }
+
+  /// Returns the number of worker threads
+  size_t thread_count() const noexcept { return pool_.size(); }
 
+  /// Returns the worker threads, to share them with work between renders
+  Thread_pool& thread_pool() noexcept { return pool_; }
+
+  /**
+   * @brief Calls callback after every tile of the following renders
+   *
+   * The callback runs on the worker threads, but never concurrently, so it
+   * does not need to be thread safe. It must be quick, workers wait for it.
+   *
+   * @pre No render is running
+   */
+  void set_progress_callback(Progress_callback callback);
+
+  /**
+   * @brief Makes the following renders stop once token is cancelled
+   *
+   * Running tiles are finished, but no tile or pass is started after the
+   * token is cancelled, and the render throws Render_cancelled once its
+   * workers are idle. The output then only has some of its tiles.
+   *
+   * @pre No render is running
+   */
+  void set_cancellation_token(Cancellation_token token);
+
+  /**
+   * @brief Renders image with sample_per_pixel samples per pixel
+   *
+   * The workers render their tiles straight into image, so the pixels of a
+   * tile are final as soon as it is reported done.
+   */
   void run(const Scene& scene, const Camera& camera, Image& image,
            size_t sample_per_pixel);
 
+  /**
+   * @brief Renders several views of the same scene
+   *
+   * Views share the scene, its acceleration structure and the thread pool.
+   * Tiles of all views are interleaved in one queue, so workers stay busy
+   * until the last tile of the last view. Each image is the same as if its
+   * job had been rendered alone.
+   *
+   * @pre The images of jobs are distinct
+   */
+  void run(const Scene& scene, const std::vector<Render_job>& jobs);
+
+  /**
+   * @brief Renders into a tiled image file instead of an in-memory Image
+   *
+   * Each finished tile is written to the file and released immediately, so
+   * memory use is bounded by the number of worker threads rather than by the
+   * resolution of the output.
+   *
+   * @pre writer.tile_size() >= settings().tile_size
+   */
+  void run(const Scene& scene, const Camera& camera,
+           Tiled_image_writer& writer, size_t sample_per_pixel);
+
+  /**
+   * @brief Progressively adds samples to film until every pixel has all the
+   * samples before sample_end
+   *
+   * The frame is rendered in passes of a few samples per pixel. After a pass,
+   * if checkpointing is enabled and the interval has elapsed, a copy of the
+   * film is saved in the background while the next pass renders. The last
+   * pass is always saved.
+   *
+   * Pixels that already have samples, for example in a film loaded from a
+   * checkpoint, only receive the missing ones, so resuming an interrupted
+   * render continues it where the checkpoint left off. A film whose first
+   * sample is not 0 receives the samples from its first sample to
+   * sample_end, which splits a frame into sample ranges that Film::merge
+   * adds back up.
+   */
+  void run(const Scene& scene, const Camera& camera, Film& film,
+           size_t sample_end, const Checkpoint_settings& checkpoint = {});
+
+  /**
+   * @brief Renders image progressively until deadline, or until it has
+   * max_sample_per_pixel samples per pixel
+   *
+   * Passes start at one sample per pixel and double up to a few samples. The
+   * duration of a pass predicts the next one, which is shrunk to end before
+   * deadline, or not started if not even one sample would. Should a pass
+   * still reach the deadline, its remaining tiles are skipped, and the tiles
+   * it finished keep their extra samples.
+   *
+   * @return The number of samples every pixel received, pixels of finished
+   * tiles of a pass cut short received more. The image is black if it is 0.
+   */
+  size_t run(const Scene& scene, const Camera& camera, Image& image,
+             Render_clock::time_point deadline,
+             size_t max_sample_per_pixel = std::numeric_limits<size_t>::max());
+
+  /**
+   * @brief Renders tile_count tiles of a width x height frame, starting at
+   * first_tile
+   *
+   * Tiles are numbered row by row, in steps of settings().tile_size. The
+   * result is the same as the part of the frame run renders into an Image.
+   *
+   * @pre first_tile + tile_count does not exceed the number of tiles
+   */
+  std::vector<Tile> render_tiles(const Scene& scene, const Camera& camera,
+                                 size_t width, size_t height,
+                                 size_t first_tile, size_t tile_count,
+                                 size_t sample_per_pixel);
+
 private:
-  indicators::ProgressBar progress_bar_{};
+  // Adds passes of samples to film until sample_end or deadline, returns the
+  // sample every pixel reached
+  size_t render_passes(const Scene& scene, const Camera& camera, Film& film,
+                       size_t sample_end, Render_clock::time_point deadline,
+                       const Checkpoint_settings& checkpoint);
+
+  Render_settings settings_;
+  Progress_callback progress_callback_;
+  Cancellation_token cancellation_;
+  Thread_pool pool_;
 };
 
 #endif // PATHTRACER_HPP
@@ -0,0 +1,123 @@
+/**
+ * @file random.hpp
+ * @brief Small-state random number generators
+ */
+
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/** \addtogroup math
+ *  @{
+ */
+
+/**
+ * @brief Converts 32 random bits into a uniformly distributed float in [0, 1)
+ *
+ * Only the upper 24 bits are used so every result is exactly representable
+ * and 1 is never returned.
+ */
+constexpr float uint_to_float(std::uint32_t bits) noexcept
+{
+  return static_cast<float>(bits >> 8) * 0x1p-24f;
+}
+
+/**
+ * @brief The PCG32 generator by Melissa O'Neill (XSH RR variant)
+ *
+ * It has 16 bytes of state and satisfies the UniformRandomBitGenerator
+ * requirements, so it can drive the standard distributions.
+ *
+ * @see https://www.pcg-random.org
+ */
+class Pcg32 {
+public:
+  using result_type = std::uint32_t;
+
+  /**
+   * @brief Creates a generator
+   * @param seed Starting state
+   * @param stream Selects one of 2^63 independent sequences
+   */
+  constexpr explicit Pcg32(
+      std::uint64_t seed = 0x853C49E6748FEA9Bull,
+      std::uint64_t stream = 0xDA3E39CB94B95BDBull) noexcept
+      : increment_{(stream << 1u) | 1u}
+  {
+    next();
+    state_ += seed;
+    next();
+  }
+
+  /// Returns the next 32 random bits
+  constexpr std::uint32_t next() noexcept
+  {
+    const auto old = state_;
+    state_ = old * 6364136223846793005ull + increment_;
+    const auto xorshifted =
+        static_cast<std::uint32_t>(((old >> 18u) ^ old) >> 27u);
+    const auto rotation = static_cast<std::uint32_t>(old >> 59u);
+    return (xorshifted >> rotation) | (xorshifted << ((0u - rotation) & 31u));
+  }
+
+  /// Returns the next uniformly distributed float in [0, 1)
+  constexpr float next_float() noexcept { return uint_to_float(next()); }
+
+  constexpr std::uint32_t operator()() noexcept { return next(); }
+  static constexpr std::uint32_t min() noexcept { return 0; }
+  static constexpr std::uint32_t max() noexcept
+  {
+    return std::numeric_limits<std::uint32_t>::max();
+  }
+
+private:
+  std::uint64_t state_ = 0;
+  std::uint64_t increment_;
+};
+
+/**
+ * @brief The Philox4x32-10 counter-based generator by Salmon et al.
+ *
+ * Philox has no state: it is a keyed bijection that maps a 128-bit counter to
+ * 128 random bits. Any element of a random sequence can be computed directly
+ * from its index, which is what makes renders reproducible regardless of how
+ * work is scheduled.
+ *
+ * @see Salmon et al. 2011, Parallel Random Numbers: As Easy as 1, 2, 3
+ */
+struct Philox4x32 {
+  using Counter = std::array<std::uint32_t, 4>;
+  using Key = std::array<std::uint32_t, 2>;
+
+  /// Returns the 128 random bits for counter under key
+  static constexpr Counter generate(Counter counter, Key key) noexcept
+  {
+    constexpr std::uint32_t multiplier0 = 0xD2511F53;
+    constexpr std::uint32_t multiplier1 = 0xCD9E8D57;
+    constexpr std::uint32_t weyl0 = 0x9E3779B9;
+    constexpr std::uint32_t weyl1 = 0xBB67AE85;
+
+    for (int round = 0; round < 10; ++round) {
+      const std::uint64_t product0 =
+          static_cast<std::uint64_t>(multiplier0) * counter[0];
+      const std::uint64_t product1 =
+          static_cast<std::uint64_t>(multiplier1) * counter[2];
+      counter = {static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^
+                     key[0],
+                 static_cast<std::uint32_t>(product1),
+                 static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^
+                     key[1],
+                 static_cast<std::uint32_t>(product0)};
+      key[0] += weyl0;
+      key[1] += weyl1;
+    }
+    return counter;
+  }
+};
+
+/** @}*/ // math group
+
+#endif // RANDOM_HPP
@@ -16,6 +16,9 @@ struct Ray {
   Point3f origin = {0, 0, 0};
   Vec3f direction = {1, 0, 0};
 
+  /// When the ray was cast, in the [0, 1] interval objects move over
+  float time = 0;
+
   /**
    * @brief Default construct a ray with origin at <0,0,0> and facing 0
    * direciton
@@ -26,7 +29,10 @@ struct Ray {
    * @brief Construct a ray by its origin and direction
    * @related Ray
    */
-  constexpr Ray(Point3f a, Vec3f b) : origin{a}, direction{b} {}
+  constexpr Ray(Point3f a, Vec3f b, float t = 0)
+      : origin{a}, direction{b}, time{t}
+  {
+  }
 
   /**
    * @brief Gets the result point after we put the parameter t into the ray
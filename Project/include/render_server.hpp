@@ -0,0 +1,149 @@
+/**
+ * @file render_server.hpp
+ * @brief A long-running process that renders requests sent over a Unix
+ * domain socket
+ *
+ * Launching a render process per frame pays for process start, scene
+ * creation and BVH build every time. A Render_server keeps the most recently
+ * used scenes and their acceleration structures in memory, and renders every
+ * request with the same Path_tracer and thread pool, so a small preview only
+ * costs its rendering.
+ *
+ * Requests are served one at a time, each one using all the threads. Only
+ * available on POSIX systems.
+ */
+
+#ifndef RENDER_SERVER_HPP
+#define RENDER_SERVER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "pathtracer.hpp"
+#include "point.hpp"
+#include "scene.hpp"
+#include "vector.hpp"
+
+class Image;
+
+/**
+ * @brief A frame a client asks a Render_server for
+ */
+struct Render_request {
+  /// Name of the scene, given to the scene loader of the server
+  std::string scene;
+
+  /// Image file the server saves the frame to
+  std::string output;
+
+  /**
+   * @brief Size of the frame, a server refuses frames with a side above
+   * 65536 pixels or more than 2^28 pixels
+   */
+  size_t width = 0;
+  size_t height = 0;
+
+  /// A server refuses more than 2^20 samples per pixel
+  size_t sample_per_pixel = 1;
+
+  Point3f position{};
+  Point3f lookat{0, 0, -1};
+  Vec3f up{0, 1, 0};
+
+  /// Vertical field of view in degrees
+  float fov = 40;
+
+  float aperture = 0;
+  float focus_distance = 1;
+};
+
+/**
+ * @brief The answer of a Render_server to a request
+ */
+struct Render_reply {
+  bool ok = false;
+
+  /// The reason of a failure, empty on success
+  std::string message;
+};
+
+/// Creates the scene of a name, or throws if the name is unknown
+using Scene_loader = std::function<Scene(const std::string& name)>;
+
+class Render_server {
+public:
+  /**
+   * @brief Creates a server that keeps up to scene_capacity scenes in memory
+   * @param loader Creates the scenes requests refer to
+   */
+  Render_server(Scene_loader loader, size_t scene_capacity,
+                const Render_settings& settings = {});
+
+  Render_server(const Render_server&) = delete;
+  Render_server& operator=(const Render_server&) = delete;
+
+  /**
+   * @brief Serves the requests sent to socket_path, until a client asks the
+   * server to stop
+   *
+   * A request that fails, for example because its scene is unknown or its
+   * output cannot be written, is answered with the error and the server goes
+   * on.
+   *
+   * @throw std::runtime_error if the socket cannot be created
+   */
+  void serve(const std::string& socket_path);
+
+  /**
+   * @brief Renders request into image, creating its scene if it is not in
+   * memory
+   *
+   * @pre image has the size of the request
+   */
+  void render(const Render_request& request, Image& image);
+
+  /// Number of requests whose scene was in memory
+  size_t scene_hits() const { return scene_hits_; }
+
+  /// Number of requests whose scene had to be created
+  size_t scene_misses() const { return scene_misses_; }
+
+private:
+  const Scene& scene(const std::string& name);
+
+  Scene_loader loader_;
+  size_t scene_capacity_;
+  Path_tracer path_tracer_;
+
+  // Most recently used scenes are at the front of lru_
+  std::list<std::pair<std::string, Scene>> lru_;
+  std::unordered_map<std::string,
+                     std::list<std::pair<std::string, Scene>>::iterator>
+      scenes_;
+  size_t scene_hits_ = 0;
+  size_t scene_misses_ = 0;
+};
+
+/**
+ * @brief Sends request to the server at socket_path and waits until the
+ * frame is saved
+ *
+ * @throw std::runtime_error if no server listens at socket_path or the
+ * connection is lost
+ */
+Render_reply send_render_request(const std::string& socket_path,
+                                 const Render_request& request);
+
+/**
+ * @brief Asks the server at socket_path to stop once it answered the requests
+ * before this one
+ *
+ * @throw std::runtime_error if no server listens at socket_path
+ */
+void send_stop_request(const std::string& socket_path);
+
+#endif // RENDER_SERVER_HPP
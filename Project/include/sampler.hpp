@@ -0,0 +1,61 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <cstdint>
+
+#include "point.hpp"
+#include "random.hpp"
+
+/**
+ * @brief Deterministic source of random numbers for one sample of one pixel
+ *
+ * The i-th number drawn from a sampler is generated by Philox4x32 from the
+ * counter (pixel, sample index, i / 4) under a key made from the seed. It
+ * does not depend on which thread takes the sample or on what was rendered
+ * before, so a render is reproducible for a given seed.
+ */
+class Sampler {
+public:
+  constexpr Sampler(std::uint64_t seed, std::uint64_t pixel_index,
+                    std::uint64_t sample_index) noexcept
+      : key_{static_cast<std::uint32_t>(seed),
+             static_cast<std::uint32_t>(seed >> 32) ^
+                 static_cast<std::uint32_t>(sample_index >> 32)},
+        counter_{static_cast<std::uint32_t>(pixel_index),
+                 static_cast<std::uint32_t>(pixel_index >> 32),
+                 static_cast<std::uint32_t>(sample_index), 0}
+  {
+  }
+
+  /// Returns the next uniformly distributed number in [0, 1)
+  constexpr float next_1d() noexcept
+  {
+    // One Philox call gives four numbers
+    const auto lane = dimension_ % 4;
+    if (lane == 0) {
+      counter_[3] = static_cast<std::uint32_t>(dimension_ / 4);
+      block_ = Philox4x32::generate(counter_, key_);
+    }
+    ++dimension_;
+    return uint_to_float(block_[lane]);
+  }
+
+  /// Returns the next point uniformly distributed in [0, 1)^2
+  constexpr Point2f next_2d() noexcept
+  {
+    const float x = next_1d();
+    const float y = next_1d();
+    return Point2f{x, y};
+  }
+
+  /// Returns how many numbers have been drawn so far
+  constexpr std::uint64_t dimension() const noexcept { return dimension_; }
+
+private:
+  Philox4x32::Key key_;
+  Philox4x32::Counter counter_;
+  Philox4x32::Counter block_{};
+  std::uint64_t dimension_ = 0;
+};
+
+#endif // SAMPLER_HPP
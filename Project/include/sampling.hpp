@@ -0,0 +1,89 @@
+/**
+ * @file sampling.hpp
+ * @brief Warps uniform samples in [0, 1)^2 to common distributions
+ */
+
+#ifndef SAMPLING_HPP
+#define SAMPLING_HPP
+
+#include <algorithm>
+#include <cmath>
+
+#include "angle.hpp"
+#include "point.hpp"
+#include "vector.hpp"
+
+/** \addtogroup math
+ *  @{
+ */
+
+/**
+ * @brief Maps u to a point uniformly distributed on the unit disk
+ *
+ * Shirley and Chiu's concentric mapping keeps neighbouring samples close,
+ * which preserves the stratification of u.
+ */
+inline Point2f concentric_sample_disk(Point2f u) noexcept
+{
+  const float x = 2 * u.x - 1;
+  const float y = 2 * u.y - 1;
+  if (x == 0 && y == 0) {
+    return Point2f{0, 0};
+  }
+
+  float r, theta;
+  if (std::abs(x) > std::abs(y)) {
+    r = x;
+    theta = pi / 4 * (y / x);
+  }
+  else {
+    r = y;
+    theta = pi / 2 - pi / 4 * (x / y);
+  }
+  return Point2f{r * std::cos(theta), r * std::sin(theta)};
+}
+
+/**
+ * @brief Maps u to a direction uniformly distributed on the unit sphere
+ */
+inline Vec3f uniform_sample_sphere(Point2f u) noexcept
+{
+  const float z = 1 - 2 * u.x;
+  const float r = std::sqrt(std::max(0.f, 1 - z * z));
+  const float phi = 2 * pi * u.y;
+  return Vec3f{r * std::cos(phi), r * std::sin(phi), z};
+}
+
+/// Density of uniform_sample_sphere with respect to solid angle
+constexpr float uniform_sphere_pdf() noexcept { return 1 / (4 * pi); }
+
+/**
+ * @brief Maps (u, w) to a point uniformly distributed inside the unit sphere
+ */
+inline Vec3f uniform_sample_ball(Point2f u, float w) noexcept
+{
+  return uniform_sample_sphere(u) * std::cbrt(w);
+}
+
+/**
+ * @brief Maps u to a cosine-weighted direction on the hemisphere around +z
+ *
+ * Uses Malley's method: points uniform on the disk projected up to the
+ * hemisphere.
+ */
+inline Vec3f cosine_sample_hemisphere(Point2f u) noexcept
+{
+  const auto d = concentric_sample_disk(u);
+  const float z = std::sqrt(std::max(0.f, 1 - d.x * d.x - d.y * d.y));
+  return Vec3f{d.x, d.y, z};
+}
+
+/// Density of cosine_sample_hemisphere with respect to solid angle
+constexpr float cosine_hemisphere_pdf(float cos_theta) noexcept
+{
+  return cos_theta / pi;
+}
+
+/** @}*/ // math group
+
+#endif // SAMPLING_HPP
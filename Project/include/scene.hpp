@@ -1,12 +1,12 @@
 #ifndef SCENE_HPP
 #define SCENE_HPP
 
-#include <memory>
-#include <type_traits>
-#include <vector>
+#include <utility>
 
+#include "arena.hpp"
 #include "camera.hpp"
 #include "hitable.hpp"
+#include "mapped_file.hpp"
 #include "material.hpp"
 
 /**
@@ -16,12 +16,15 @@ class Scene {
 public:
   /**
    * @brief Constructs a Scene object
+   * @param arena The arena that holds the primitives, acceleration structure
+   * and materials of the scene, which are released all at once with it
    * @param aggregate The combination of all objects in the scene
-   * @param materials Ownership of all materials used for the scene
+   * @param file A mapped file the aggregate reads from, if any
    */
-  Scene(std::unique_ptr<Hitable>&& aggregate,
-        std::vector<std::unique_ptr<Material>>&& materials) noexcept
-      : aggregate_{std::move(aggregate)}, materials_{std::move(materials)}
+  Scene(Arena&& arena, const Hitable& aggregate,
+        Mapped_file&& file = {}) noexcept
+      : arena_{std::move(arena)}, file_{std::move(file)},
+        aggregate_{&aggregate}
   {
   }
 
@@ -31,8 +34,9 @@ public:
   Maybe_hit_t intersect_at(const Ray& r) const noexcept;
 
 private:
-  std::unique_ptr<const Hitable> aggregate_ = nullptr;
-  std::vector<std::unique_ptr<Material>> materials_;
+  Arena arena_;
+  Mapped_file file_;
+  const Hitable* aggregate_ = nullptr;
 };
 
 #endif // SCENE_HPP
@@ -0,0 +1,86 @@
+/**
+ * @file scene_cache.hpp
+ * @brief Binary cache of the primitives and the built BVH of a scene
+ *
+ * A cache file holds a header, the nodes of a Compressed_BVH and one fixed
+ * size record per primitive, in the order the leaves refer to them. Nothing
+ * in it is a pointer: nodes refer to each other and to leaves by index, and
+ * each record gives the index of its primitive in the list of the scene and
+ * the index of its material in a palette. Loading a scene uses the
+ * primitives it already created and the nodes in place from a memory mapping
+ * of the file, so it builds nothing.
+ *
+ * Files are written in the byte order and layout of the machine writing
+ * them. A file from another layout, format version or scene content is
+ * detected and ignored.
+ */
+
+#ifndef SCENE_CACHE_HPP
+#define SCENE_CACHE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+class Arena;
+class Compressed_BVH;
+class Material;
+struct Hitable;
+
+/**
+ * @brief Hash of the geometry of a scene, used as the key of its cache
+ *
+ * Covers the type, parameters, material index and order of every primitive,
+ * as well as the version of the cache format.
+ *
+ * @throw std::invalid_argument if a primitive cannot be stored in a cache,
+ * or uses a material missing from palette
+ */
+std::uint64_t scene_content_key(const std::vector<Hitable*>& primitives,
+                                const std::vector<const Material*>& palette);
+
+/**
+ * @brief Writes bvh and its primitives to a cache file
+ *
+ * Spheres and axis aligned rectangles are supported. primitives is the
+ * list of the scene in the order key was computed for, before building the
+ * BVH reordered it.
+ *
+ * @throw std::invalid_argument if a primitive cannot be stored in a cache,
+ * is missing from primitives or uses a material missing from palette
+ * @throw Cannot_write_file if the file cannot be written
+ */
+void write_scene_cache(const std::string& filename, std::uint64_t key,
+                       const Compressed_BVH& bvh,
+                       const std::vector<Hitable*>& primitives,
+                       const std::vector<const Material*>& palette);
+
+/**
+ * @brief The aggregate of a scene loaded from a cache file, and the mapping
+ * its nodes are read from
+ */
+struct Cached_aggregate {
+  Mapped_file file;
+  const Compressed_BVH* aggregate = nullptr;
+};
+
+/**
+ * @brief Loads a cache file written by write_scene_cache
+ *
+ * The leaves refer to primitives, which must be the list key was computed
+ * for and outlive the result. The leaf list and the Compressed_BVH are
+ * created in arena, the nodes stay in the mapped file.
+ *
+ * @return Nothing if the file is missing, unreadable, from another format or
+ * machine layout, was written for another key, or holds nodes or records
+ * that do not fit primitives
+ */
+std::optional<Cached_aggregate>
+load_scene_cache(const std::string& filename, std::uint64_t key, Arena& arena,
+                 const std::vector<Hitable*>& primitives,
+                 const std::vector<const Material*>& palette);
+
+#endif // SCENE_CACHE_HPP
@@ -14,21 +14,42 @@
 #include "point.hpp"
 
 struct Sphere : Hitable {
-  Point3f center{};
+  Point3f center{}; ///< Center at time 0
   float radius = 1;
+  Vec3f motion{}; ///< Displacement of the center from time 0 to time 1
 
   Sphere(Point3f center, float radius, const Material& mat)
       : center{center}, radius{radius}, material{&mat}
   {
   }
 
+  /**
+   * @brief Constructs a sphere moving linearly from center0 at time 0 to
+   * center1 at time 1
+   */
+  Sphere(Point3f center0, Point3f center1, float radius, const Material& mat)
+      : center{center0}, radius{radius}, motion{center1 - center0},
+        material{&mat}
+  {
+  }
+
+  /// Returns the center at a time in [0, 1]
+  Point3f center_at(float time) const noexcept
+  {
+    return center + time * motion;
+  }
+
   std::optional<AABB> bounding_box() const noexcept override;
+  std::optional<AABB> bounding_box_at(float time) const noexcept override;
 
   /**
    * @brief Ray-sphere intersection detection
    * @see Hitable::intersect_at
    */
-  Maybe_hit_t intersect_at(const Ray& r, float t_min, float t_max) const
+  Maybe_intersection_t intersect_at(const Ray& r, float t_min,
+                                    float t_max) const noexcept override;
+
+  Hit_record surface_at(const Ray& r, const Intersection& intersection) const
       noexcept override;
 
   const Material* const material;
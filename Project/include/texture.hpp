@@ -1,4 +1,76 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
+#include <string>
+
+#include "color.hpp"
+#include "hitable.hpp"
+
+class Texture_cache;
+
+/**
+ * @brief A color that varies over a surface
+ */
+class Texture {
+public:
+  virtual ~Texture() = default;
+
+  /// Returns the color of the texture at a hit point
+  virtual Color value(const Hit_record& record) const = 0;
+};
+
+class Constant_texture : public Texture {
+public:
+  explicit Constant_texture(Color color) noexcept : color_{color} {}
+
+  Color value(const Hit_record& record) const override;
+
+private:
+  Color color_;
+};
+
+/**
+ * @brief Alternates between two textures in a checkerboard pattern over uv
+ */
+class Checker_texture : public Texture {
+public:
+  /**
+   * @param even, odd Textures of the two kinds of squares
+   * @param frequency Number of squares along each of u and v
+   */
+  Checker_texture(const Texture& even, const Texture& odd,
+                  float frequency) noexcept
+      : even_{&even}, odd_{&odd}, frequency_{frequency}
+  {
+  }
+
+  Color value(const Hit_record& record) const override;
+
+private:
+  const Texture* even_;
+  const Texture* odd_;
+  float frequency_;
+};
+
+/**
+ * @brief Texture backed by an image file in a Texture_cache
+ *
+ * The image repeats outside [0, 1]^2, with v = 0 at its bottom row. Lookups
+ * are bilinear, and trilinear between mip levels when the hit record has a uv
+ * footprint.
+ */
+class Image_texture : public Texture {
+public:
+  /// Registers the file in the cache, which must outlive the texture
+  Image_texture(Texture_cache& cache, std::string filename);
+
+  Color value(const Hit_record& record) const override;
+
+private:
+  Color bilinear(size_t level, Point2f uv) const;
+
+  Texture_cache* cache_;
+  size_t id_;
+};
+
 #endif // TEXTURE_HPP
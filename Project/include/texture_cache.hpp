@@ -0,0 +1,139 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include <array>
+#include <cstdint>
+#include <ios>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "color.hpp"
+
+/**
+ * @brief Shared, memory-bounded store of image texture texels
+ *
+ * Every registered image is split into a mip-map pyramid of square tiles.
+ * Tiles are only created when a texel inside them is looked up: level 0 tiles
+ * are read from the file, coarser tiles are box filtered from the four tiles
+ * below them. When the tiles in memory exceed the budget, the least recently
+ * used ones are evicted and recreated on their next use.
+ *
+ * Supported files are binary PPM and PGM (8 bit, decoded with gamma 2 to
+ * match Image::saveto) and PFM (linear float, RGB or grayscale).
+ *
+ * All member functions may be called from several threads at the same time.
+ */
+class Texture_cache {
+public:
+  /// Width and height in texels of a tile
+  static constexpr size_t tile_size = 32;
+
+  /**
+   * @brief Creates an empty cache
+   * @param memory_budget Bytes of tile data kept in memory. The most recently
+   * used tile is kept even if it alone exceeds the budget.
+   */
+  explicit Texture_cache(size_t memory_budget);
+
+  Texture_cache(const Texture_cache&) = delete;
+  Texture_cache& operator=(const Texture_cache&) = delete;
+
+  /**
+   * @brief Registers an image file and returns its texture id
+   *
+   * The header of the file is read and checked at once, while the scene is
+   * built, but its texels are only read when they are first used.
+   *
+   * @throw std::runtime_error if the file cannot be opened, is not a
+   * supported image or is shorter than its header says
+   */
+  size_t add(std::string filename);
+
+  /// Returns the size of the mip level of a texture
+  std::array<size_t, 2> size(size_t texture, size_t level);
+
+  /// Returns the number of mip levels of a texture, down to 1x1
+  size_t level_count(size_t texture);
+
+  /**
+   * @brief Returns a texel of a mip level
+   * @pre x and y are inside the level
+   * @throw std::runtime_error if the file can no longer be read
+   */
+  Color texel(size_t texture, size_t level, size_t x, size_t y);
+
+  size_t memory_budget() const { return memory_budget_; }
+
+  /// Bytes of tile data currently in memory
+  size_t memory_used() const;
+
+  /// Number of tile lookups that found the tile in memory
+  size_t hits() const;
+
+  /// Number of tile lookups that had to load or filter the tile
+  size_t misses() const;
+
+private:
+  struct Tile {
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<Color> texels;
+  };
+  using Tile_ptr = std::shared_ptr<const Tile>;
+
+  struct Tile_key {
+    std::uint32_t texture;
+    std::uint32_t level;
+    std::uint32_t x;
+    std::uint32_t y;
+
+    bool operator==(const Tile_key& rhs) const
+    {
+      return texture == rhs.texture && level == rhs.level && x == rhs.x &&
+             y == rhs.y;
+    }
+  };
+
+  struct Tile_key_hash {
+    size_t operator()(const Tile_key& key) const noexcept;
+  };
+
+  /// What is known about an image file once its header was read
+  struct Image_file {
+    std::string filename;
+    size_t channels = 3;   ///< 1 for grayscale, 3 for RGB
+    bool is_float = false; ///< PFM if true, PPM/PGM otherwise
+    bool is_big_endian = false;
+    float scale = 1; ///< Maps stored 8 bit values to [0, 1]
+    std::streamoff data_offset = 0;
+    std::vector<std::array<size_t, 2>> level_sizes;
+  };
+
+  static std::unique_ptr<const Image_file>
+  read_header(const std::string& filename);
+  const Image_file& file(size_t texture) const;
+  Tile_ptr tile(const Tile_key& key);
+  Tile load_tile(const Image_file& image, const Tile_key& key) const;
+  Tile filter_tile(const Image_file& image, const Tile_key& key);
+
+  size_t memory_budget_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<const Image_file>> files_;
+
+  // Most recently used tiles are at the front of lru_
+  std::list<std::pair<Tile_key, Tile_ptr>> lru_;
+  std::unordered_map<Tile_key,
+                     std::list<std::pair<Tile_key, Tile_ptr>>::iterator,
+                     Tile_key_hash>
+      tiles_;
+  size_t memory_used_ = 0;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+#endif // TEXTURE_CACHE_HPP
@@ -0,0 +1,92 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A fixed-size pool of worker threads that lives as long as its owner
+ *
+ * Unlike launching one std::async per task, the number of tasks that run at
+ * the same time is bounded by the number of workers.
+ */
+class Thread_pool {
+public:
+  /**
+   * @brief Starts thread_count workers
+   * @param thread_count Number of workers, 0 means one per hardware thread
+   */
+  explicit Thread_pool(size_t thread_count = 0);
+  ~Thread_pool();
+
+  Thread_pool(const Thread_pool&) = delete;
+  Thread_pool& operator=(const Thread_pool&) = delete;
+
+  /// Returns the number of worker threads
+  size_t size() const noexcept { return workers_.size(); }
+
+  /**
+   * @brief Schedules f to run on one of the workers
+   * @return A future that holds the result of f
+   */
+  template <typename F>
+  auto submit(F f) -> std::future<std::invoke_result_t<F>>
+  {
+    using Result = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(f));
+    auto result = task->get_future();
+    enqueue([task] { (*task)(); });
+    return result;
+  }
+
+  /**
+   * @brief Calls f(i) for every i in [0, count) and waits for all of them
+   *
+   * Workers pull the next index from a shared counter, so at most size()
+   * calls of f are in flight at the same time.
+   */
+  template <typename F> void parallel_for(size_t count, F f)
+  {
+    std::atomic<size_t> next{0};
+    std::vector<std::future<void>> results;
+    const size_t task_count = std::min(count, size());
+    results.reserve(task_count);
+    for (size_t t = 0; t < task_count; ++t) {
+      results.push_back(submit([&next, &f, count] {
+        for (size_t i = next++; i < count; i = next++) {
+          f(i);
+        }
+      }));
+    }
+
+    // Every task refers to this stack frame, so wait for all of them before
+    // rethrowing the first failure
+    for (auto& result : results) {
+      result.wait();
+    }
+    for (auto& result : results) {
+      result.get();
+    }
+  }
+
+private:
+  void enqueue(std::function<void()> task);
+  void work();
+
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_ = false;
+};
+
+#endif // THREAD_POOL_HPP
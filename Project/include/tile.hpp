@@ -30,6 +30,13 @@ public:
     return data_[j * width_ + i];
   }
 
+  /// Returns the width() pixels of row j
+  const Color* row(size_t j) const
+  {
+    assert(j < height_);
+    return data_.data() + j * width_;
+  }
+
   size_t height() const { return height_; }
   size_t width() const { return width_; }
   size_t startX() const { return startX_; }
@@ -0,0 +1,80 @@
+#ifndef TILE_SCHEDULE_HPP
+#define TILE_SCHEDULE_HPP
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief Order in which the tiles of a frame are handed to the workers
+ *
+ * The image does not depend on it, only the time it takes and the parts of
+ * it that are finished first.
+ */
+enum class Tile_order {
+  /// Row by row, from the top left corner
+  row_major,
+
+  /**
+   * @brief Along a Hilbert curve
+   *
+   * Consecutive tiles are neighbours, so the workers render nearby tiles at
+   * the same time and share the parts of the scene they hit in cache.
+   */
+  hilbert,
+
+  /// From the center of the frame outwards, for previews
+  spiral,
+};
+
+/**
+ * @brief A rectangle of pixels that a worker renders as one unit
+ */
+struct Tile_rect {
+  size_t x = 0; ///< Column of the first pixel
+  size_t y = 0; ///< Row of the first pixel
+  size_t width = 0;
+  size_t height = 0;
+
+  /// Index of the frame of the tile, when several are rendered together
+  size_t frame = 0;
+};
+
+/**
+ * @brief Returns the tiles of a width x height frame in order
+ *
+ * Tiles are tile_size pixels wide and high, except on the right and bottom
+ * edges of the frame.
+ *
+ * @pre tile_size > 0
+ */
+std::vector<Tile_rect> ordered_tiles(size_t width, size_t height,
+                                     size_t tile_size, Tile_order order);
+
+/**
+ * @brief Tiles that workers take one at a time, splitting the last ones
+ *
+ * While there are more tiles than workers, tiles are taken as they are. Once
+ * fewer remain, some workers would wait for the others to finish the last
+ * large tiles, so a taken tile larger than min_tile_size is split into
+ * quarters: the worker renders the first one and the others go back to the
+ * front of the queue, for the idle workers.
+ */
+class Tile_queue {
+public:
+  Tile_queue(const std::vector<Tile_rect>& tiles, size_t worker_count,
+             size_t min_tile_size = 8);
+
+  /// Returns the next tile, or nothing once every tile was taken
+  std::optional<Tile_rect> pop();
+
+private:
+  std::mutex mutex_;
+  std::deque<Tile_rect> tiles_;
+  size_t worker_count_;
+  size_t min_tile_size_;
+};
+
+#endif // TILE_SCHEDULE_HPP
@@ -0,0 +1,80 @@
+/**
+ * @file tiled_image_file.hpp
+ * @brief Raw tiled float image format for renders that do not fit in memory
+ *
+ * A file starts with a header (magic "PTTI", version, width, height, tile
+ * size), followed by one record per tile in the order they were written. Each
+ * record holds the tile rectangle (x, y, width, height) and its pixels as
+ * row-major 32-bit float RGB triples. All values are in native byte order.
+ */
+
+#ifndef TILED_IMAGE_FILE_HPP
+#define TILED_IMAGE_FILE_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include "image.hpp"
+#include "tile.hpp"
+
+/**
+ * @brief Streams finished tiles into a raw tiled image file
+ *
+ * Only the tile being written is held in memory, so the size of the output is
+ * not bounded by available memory. It is safe to write tiles from several
+ * threads at the same time.
+ */
+class Tiled_image_writer {
+public:
+  /**
+   * @brief Creates the file and writes its header
+   * @throw Cannot_write_file if the file cannot be opened
+   */
+  Tiled_image_writer(const std::string& filename, size_t width, size_t height,
+                     size_t tile_size);
+
+  /// Closes the file if close() was not called, ignoring errors
+  ~Tiled_image_writer();
+
+  Tiled_image_writer(const Tiled_image_writer&) = delete;
+  Tiled_image_writer& operator=(const Tiled_image_writer&) = delete;
+
+  size_t width() const { return width_; }
+  size_t height() const { return height_; }
+  size_t tile_size() const { return tile_size_; }
+
+  /**
+   * @brief Appends a finished tile to the file
+   * @pre The tile lies inside the image and is at most tile_size() wide/high
+   */
+  void write(const Tile& tile);
+
+  /**
+   * @brief Flushes the written tiles and closes the file
+   *
+   * Only a successful close() guarantees that the file is complete. No tile
+   * may be written afterwards.
+   *
+   * @throw Cannot_write_file if the tiles cannot be written
+   */
+  void close();
+
+private:
+  std::string filename_;
+  size_t width_;
+  size_t height_;
+  size_t tile_size_;
+  std::ofstream file_;
+  std::mutex mutex_;
+};
+
+/**
+ * @brief Reads a raw tiled image file and assembles it into an Image
+ * @throw std::runtime_error if the file is missing, truncated or not a tiled
+ * image file
+ */
+Image read_tiled_image(const std::string& filename);
+
+#endif // TILED_IMAGE_FILE_HPP
@@ -0,0 +1,238 @@
+/**
+ * @file transform.hpp
+ * @brief Affine transformations of points, vectors, normals and boxes
+ */
+
+#ifndef TRANSFORM_HPP
+#define TRANSFORM_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "aabb.hpp"
+#include "angle.hpp"
+#include "point.hpp"
+#include "ray.hpp"
+#include "vector.hpp"
+
+/** \addtogroup math
+ *  @{
+ */
+
+/**
+ * @brief An invertible affine transformation
+ *
+ * The inverse is kept alongside the matrix, so inverting a transform and
+ * transforming normals cost no matrix inversion.
+ */
+class Transform {
+public:
+  /// Constructs the identity transform
+  constexpr Transform() noexcept = default;
+
+  static constexpr Transform translate(Vec3f offset) noexcept
+  {
+    return Transform{Matrix{{{1, 0, 0, offset.x},
+                             {0, 1, 0, offset.y},
+                             {0, 0, 1, offset.z}}},
+                     Matrix{{{1, 0, 0, -offset.x},
+                             {0, 1, 0, -offset.y},
+                             {0, 0, 1, -offset.z}}}};
+  }
+
+  /// @pre No factor is 0
+  static constexpr Transform scale(Vec3f factors) noexcept
+  {
+    return Transform{Matrix{{{factors.x, 0, 0, 0},
+                             {0, factors.y, 0, 0},
+                             {0, 0, factors.z, 0}}},
+                     Matrix{{{1 / factors.x, 0, 0, 0},
+                             {0, 1 / factors.y, 0, 0},
+                             {0, 0, 1 / factors.z, 0}}}};
+  }
+
+  /**
+   * @brief Rotates counterclockwise around an axis through the origin
+   * @param axis Unit vector the rotation is counterclockwise around
+   */
+  static Transform rotate(Vec3f axis, Radian angle) noexcept
+  {
+    const float c = std::cos(angle.value());
+    const float s = std::sin(angle.value());
+    const float k = 1 - c;
+    const float x = axis.x, y = axis.y, z = axis.z;
+    const Matrix m{{{k * x * x + c, k * x * y - s * z, k * x * z + s * y, 0},
+                    {k * x * y + s * z, k * y * y + c, k * y * z - s * x, 0},
+                    {k * x * z - s * y, k * y * z + s * x, k * z * z + c, 0}}};
+
+    // The inverse of a rotation is its transpose
+    Matrix inverse{};
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        inverse[i][j] = m[j][i];
+      }
+    }
+    return Transform{m, inverse};
+  }
+
+  constexpr Transform inverse() const noexcept
+  {
+    return Transform{inverse_, matrix_};
+  }
+
+  /**
+   * @brief Linearly interpolates the matrices of two transforms
+   *
+   * Every point moves on a straight line from where start puts it to where
+   * end puts it.
+   *
+   * @pre The interpolated matrix is invertible
+   */
+  static Transform lerp(const Transform& start, const Transform& end,
+                        float t) noexcept
+  {
+    Matrix m{};
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        m[i][j] = (1 - t) * start.matrix_[i][j] + t * end.matrix_[i][j];
+      }
+    }
+    return Transform{m, invert(m)};
+  }
+
+  /// Returns the transform that applies rhs first, then lhs
+  friend constexpr Transform operator*(const Transform& lhs,
+                                       const Transform& rhs) noexcept
+  {
+    return Transform{multiply(lhs.matrix_, rhs.matrix_),
+                     multiply(rhs.inverse_, lhs.inverse_)};
+  }
+
+  friend bool operator==(const Transform& lhs, const Transform& rhs) noexcept
+  {
+    return lhs.matrix_ == rhs.matrix_;
+  }
+
+  friend bool operator!=(const Transform& lhs, const Transform& rhs) noexcept
+  {
+    return !(lhs == rhs);
+  }
+
+  constexpr Point3f operator()(Point3f p) const noexcept
+  {
+    Point3f result{};
+    for (int i = 0; i < 3; ++i) {
+      result[i] = matrix_[i][0] * p.x + matrix_[i][1] * p.y +
+                  matrix_[i][2] * p.z + matrix_[i][3];
+    }
+    return result;
+  }
+
+  constexpr Vec3f operator()(Vec3f v) const noexcept
+  {
+    Vec3f result{};
+    for (int i = 0; i < 3; ++i) {
+      result[i] =
+          matrix_[i][0] * v.x + matrix_[i][1] * v.y + matrix_[i][2] * v.z;
+    }
+    return result;
+  }
+
+  /**
+   * @brief Transforms a ray
+   *
+   * The direction is not normalized, so a point at parameter t of the result
+   * is the transformed point at parameter t of r.
+   */
+  constexpr Ray operator()(const Ray& r) const noexcept
+  {
+    return Ray{(*this)(r.origin), (*this)(r.direction), r.time};
+  }
+
+  /// Returns the bounding box of the transformed box
+  constexpr AABB operator()(const AABB& box) const noexcept
+  {
+    Point3f low{}, high{};
+    for (int corner = 0; corner < 8; ++corner) {
+      const auto p = (*this)(Point3f{corner & 1 ? box.max().x : box.min().x,
+                                     corner & 2 ? box.max().y : box.min().y,
+                                     corner & 4 ? box.max().z : box.min().z});
+      for (int a = 0; a < 3; ++a) {
+        low[a] = corner == 0 ? p[a] : std::min(low[a], p[a]);
+        high[a] = corner == 0 ? p[a] : std::max(high[a], p[a]);
+      }
+    }
+    return AABB{low, high};
+  }
+
+  /**
+   * @brief Transforms a surface normal, which needs the inverse transpose
+   * to stay perpendicular to the surface
+   *
+   * The result is not normalized.
+   */
+  constexpr Vec3f normal(Vec3f n) const noexcept
+  {
+    Vec3f result{};
+    for (int i = 0; i < 3; ++i) {
+      result[i] =
+          inverse_[0][i] * n.x + inverse_[1][i] * n.y + inverse_[2][i] * n.z;
+    }
+    return result;
+  }
+
+private:
+  // The top three rows of a 4x4 matrix whose last row is (0, 0, 0, 1)
+  using Matrix = std::array<std::array<float, 4>, 3>;
+
+  constexpr Transform(const Matrix& matrix, const Matrix& inverse) noexcept
+      : matrix_{matrix}, inverse_{inverse}
+  {
+  }
+
+  static constexpr Matrix multiply(const Matrix& lhs,
+                                   const Matrix& rhs) noexcept
+  {
+    Matrix result{};
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        result[i][j] = lhs[i][0] * rhs[0][j] + lhs[i][1] * rhs[1][j] +
+                       lhs[i][2] * rhs[2][j] + (j == 3 ? lhs[i][3] : 0);
+      }
+    }
+    return result;
+  }
+
+  // Inverts an affine matrix by the adjugate of its linear part
+  static Matrix invert(const Matrix& m) noexcept
+  {
+    const float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    const float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    const float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    const float inv_det = 1 / (m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02);
+
+    Matrix result{};
+    result[0][0] = c00 * inv_det;
+    result[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv_det;
+    result[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv_det;
+    result[1][0] = c01 * inv_det;
+    result[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv_det;
+    result[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv_det;
+    result[2][0] = c02 * inv_det;
+    result[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv_det;
+    result[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv_det;
+    for (int i = 0; i < 3; ++i) {
+      result[i][3] = -(result[i][0] * m[0][3] + result[i][1] * m[1][3] +
+                       result[i][2] * m[2][3]);
+    }
+    return result;
+  }
+
+  Matrix matrix_ = {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}}};
+  Matrix inverse_ = {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}}};
+};
+
+/** @}*/ // math group
+
+#endif // TRANSFORM_HPP
@@ -0,0 +1,36 @@
+#include "arena.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  assert(alignment <= alignof(std::max_align_t));
+
+  const auto address = reinterpret_cast<std::uintptr_t>(current_);
+  const size_t padding = (alignment - address % alignment) % alignment;
+  if (current_ == nullptr || padding + size > remaining_) {
+    // Large objects get a block of their own, so the current block keeps
+    // serving the small ones
+    if (size > block_size_ / 4) {
+      blocks_.emplace_back(new std::byte[size]);
+      bytes_reserved_ += size;
+      bytes_used_ += size;
+      return blocks_.back().get();
+    }
+
+    // Blocks from new[] are aligned for any fundamental type
+    blocks_.emplace_back(new std::byte[block_size_]);
+    current_ = blocks_.back().get();
+    remaining_ = block_size_;
+    bytes_reserved_ += block_size_;
+    return allocate(size, alignment);
+  }
+
+  void* result = current_ + padding;
+  current_ += padding + size;
+  remaining_ -= padding + size;
+  bytes_used_ += padding + size;
+  return result;
+}
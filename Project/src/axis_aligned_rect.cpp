@@ -5,8 +5,8 @@ Vec3f flip_negative_normal(Vec3f normal, Normal_Direction d)
   return d == Normal_Direction::Negetive ? -normal : normal;
 }
 
-Maybe_hit_t Rect_XY::intersect_at(const Ray& r, float t_min, float t_max) const
-    noexcept
+Maybe_intersection_t Rect_XY::intersect_at(const Ray& r, float t_min,
+                                            float t_max) const noexcept
 {
   const float t = (z - r.origin.z) / r.direction.z;
   if (t < t_min || t > t_max) {
@@ -19,12 +19,27 @@ Maybe_hit_t Rect_XY::intersect_at(const Ray& r, float t_min, float t_max) const
     return std::nullopt;
   }
 
-  return Hit_record{t, r.point_at_parameter(t),
-                    flip_negative_normal(Vec3f(0, 0, 1), direction), material};
+  return Intersection{t, this, Point2f{x, y}};
 }
 
-Maybe_hit_t Rect_XZ::intersect_at(const Ray& r, float t_min, float t_max) const
-    noexcept
+Hit_record Rect_XY::surface_at(const Ray& /*r*/,
+                               const Intersection& intersection) const noexcept
+{
+  const auto p = intersection.coordinates;
+  const Point2f uv{(p.x - min.x) / (max.x - min.x),
+                   (p.y - min.y) / (max.y - min.y)};
+  return Hit_record{intersection.t,
+                    Point3f{p.x, p.y, z},
+                    flip_negative_normal(Vec3f(0, 0, 1), direction),
+                    material,
+                    uv,
+                    0,
+                    Vec3f{max.x - min.x, 0, 0},
+                    Vec3f{0, max.y - min.y, 0}};
+}
+
+Maybe_intersection_t Rect_XZ::intersect_at(const Ray& r, float t_min,
+                                            float t_max) const noexcept
 {
   const float t = (y - r.origin.y) / r.direction.y;
   if (t < t_min || t > t_max) {
@@ -37,12 +52,27 @@ Maybe_hit_t Rect_XZ::intersect_at(const Ray& r, float t_min, float t_max) const
     return std::nullopt;
   }
 
-  return Hit_record{t, r.point_at_parameter(t),
-                    flip_negative_normal(Vec3f(0, 1, 0), direction), material};
+  return Intersection{t, this, Point2f{x, z}};
 }
 
-Maybe_hit_t Rect_YZ::intersect_at(const Ray& r, float t_min, float t_max) const
-    noexcept
+Hit_record Rect_XZ::surface_at(const Ray& /*r*/,
+                               const Intersection& intersection) const noexcept
+{
+  const auto p = intersection.coordinates;
+  const Point2f uv{(p.x - min.x) / (max.x - min.x),
+                   (p.y - min.y) / (max.y - min.y)};
+  return Hit_record{intersection.t,
+                    Point3f{p.x, y, p.y},
+                    flip_negative_normal(Vec3f(0, 1, 0), direction),
+                    material,
+                    uv,
+                    0,
+                    Vec3f{max.x - min.x, 0, 0},
+                    Vec3f{0, 0, max.y - min.y}};
+}
+
+Maybe_intersection_t Rect_YZ::intersect_at(const Ray& r, float t_min,
+                                            float t_max) const noexcept
 {
   const float t = (x - r.origin.x) / r.direction.x;
   if (t < t_min || t > t_max) {
@@ -55,6 +85,21 @@ Maybe_hit_t Rect_YZ::intersect_at(const Ray& r, float t_min, float t_max) const
     return std::nullopt;
   }
 
-  return Hit_record{t, r.point_at_parameter(t),
-                    flip_negative_normal(Vec3f(1, 0, 0), direction), material};
+  return Intersection{t, this, Point2f{y, z}};
+}
+
+Hit_record Rect_YZ::surface_at(const Ray& /*r*/,
+                               const Intersection& intersection) const noexcept
+{
+  const auto p = intersection.coordinates;
+  const Point2f uv{(p.x - min.x) / (max.x - min.x),
+                   (p.y - min.y) / (max.y - min.y)};
+  return Hit_record{intersection.t,
+                    Point3f{x, p.x, p.y},
+                    flip_negative_normal(Vec3f(1, 0, 0), direction),
+                    material,
+                    uv,
+                    0,
+                    Vec3f{0, max.x - min.x, 0},
+                    Vec3f{0, 0, max.y - min.y}};
 }
@@ -2,61 +2,62 @@
 
 #include <algorithm>
 #include <cassert>
-#include <limits>
-#include <random>
+#include <deque>
+
+#include "arena.hpp"
+#include "thread_pool.hpp"
 
-// A dummy object that you cannot hit
 namespace {
-struct Never_hitable : Hitable {
-  std::optional<AABB> bounding_box() const noexcept override
-  {
-    constexpr auto min = std::numeric_limits<float>::min();
-    constexpr auto max = std::numeric_limits<float>::max();
-
-    // Returns a bounding box that do not bound to anything
-    return AABB{{max, max, max}, {min, min, min}};
-  }
+// Relative costs of visiting a node and of intersecting a primitive
+constexpr float traversal_cost = 0.125f;
+constexpr float intersection_cost = 1;
 
-  Maybe_hit_t intersect_at(const Ray& /*r*/, float /*t_min*/,
-                           float /*t_max*/) const noexcept override
-  {
-    return {};
+// Area weighted cost of a child subtree or primitive
+float weighted_cost(const Hitable& child) noexcept
+{
+  if (const auto node = dynamic_cast<const BVH_node*>(&child)) {
+    return node->sah_cost() * node->bounding_box()->surface_area();
   }
-};
+  const auto box = child.bounding_box();
+  return box ? intersection_cost * box->surface_area() : 0;
+}
 } // anonymous namespace
 
-BVH_node::BVH_node(const Object_iterator& begin,
-                   const Object_iterator& end) noexcept
+BVH_node::BVH_node(Arena& arena, const Object_iterator& begin,
+                   const Object_iterator& end)
 {
-  thread_local std::mt19937 gen = std::mt19937{std::random_device{}()};
-  std::uniform_int_distribution<int> dis(0, 2);
-  int axis = dis(gen);
+  // Split along the axis where the objects are spread out the most. Unlike a
+  // random axis, this gives the same tree on every run.
+  Point3f low = (*begin)->bounding_box()->min();
+  Point3f high = low;
+  for (auto i = begin; i != end; ++i) {
+    const auto corner = (*i)->bounding_box()->min();
+    for (int a = 0; a < 3; ++a) {
+      low[a] = std::min(low[a], corner[a]);
+      high[a] = std::max(high[a], corner[a]);
+    }
+  }
+  const auto extent = high - low;
+  const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                       : (extent.y > extent.z ? 1 : 2);
+
   if (axis == 0) {
     // Sort by x
-    std::sort(begin, end,
-              [](const std::unique_ptr<Hitable>& lhs,
-                 const std::unique_ptr<Hitable>& rhs) {
-                return lhs->bounding_box()->min().x <
-                       rhs->bounding_box()->min().x;
-              });
+    std::sort(begin, end, [](const Hitable* lhs, const Hitable* rhs) {
+      return lhs->bounding_box()->min().x < rhs->bounding_box()->min().x;
+    });
   }
   else if (axis == 1) {
     // Sort by y
-    std::sort(begin, end,
-              [](const std::unique_ptr<Hitable>& lhs,
-                 const std::unique_ptr<Hitable>& rhs) {
-                return lhs->bounding_box()->min().y <
-                       rhs->bounding_box()->min().y;
-              });
+    std::sort(begin, end, [](const Hitable* lhs, const Hitable* rhs) {
+      return lhs->bounding_box()->min().y < rhs->bounding_box()->min().y;
+    });
   }
   else {
     // Sort by z
-    std::sort(begin, end,
-              [](const std::unique_ptr<Hitable>& lhs,
-                 const std::unique_ptr<Hitable>& rhs) {
-                return lhs->bounding_box()->min().z <
-                       rhs->bounding_box()->min().z;
-              });
+    std::sort(begin, end, [](const Hitable* lhs, const Hitable* rhs) {
+      return lhs->bounding_box()->min().z < rhs->bounding_box()->min().z;
+    });
   }
 
   const auto size = end - begin;
@@ -64,49 +65,145 @@ BVH_node::BVH_node(const Object_iterator& begin,
 
   switch (size) {
   case 1:
-    left_ = std::move(*begin);
-    right_ = std::make_unique<Never_hitable>();
+    left_ = *begin;
     break;
   case 2:
-    left_ = std::move(*begin);
-    right_ = std::move(*(begin + 1));
+    left_ = *begin;
+    right_ = *(begin + 1);
     break;
   default:
-    left_ = std::make_unique<BVH_node>(begin, begin + size / 2);
-    right_ = std::make_unique<BVH_node>(begin + size / 2, end);
+    left_ = arena.create<BVH_node>(arena, begin, begin + size / 2);
+    right_ = arena.create<BVH_node>(arena, begin + size / 2, end);
   }
 
-  assert(left_->bounding_box() != std::nullopt &&
-         right_->bounding_box() != std::nullopt);
-  box_ = surrounding_box(*left_->bounding_box(), *right_->bounding_box());
+  refit_node();
+  build_sah_cost_ = sah_cost();
 }
 
-Maybe_hit_t BVH_node::intersect_at(const Ray& r, float t_min, float t_max) const
-    noexcept
+Maybe_intersection_t BVH_node::intersect_at(const Ray& r, float t_min,
+                                            float t_max) const noexcept
 {
-  assert(left_ != nullptr && right_ != nullptr);
+  assert(left_ != nullptr);
 
-  if (!box_.hit(r, t_min, t_max)) {
+  const auto box = is_moving_ ? lerp(box0_, box1_, r.time) : box0_;
+  if (!box.hit(r, t_min, t_max)) {
     return {};
   }
 
-  const auto hit_left_record = left_->intersect_at(r, t_min, t_max);
-  const auto hit_right_record = right_->intersect_at(r, t_min, t_max);
-  if (hit_left_record && hit_right_record) {
-    if (hit_left_record->t < hit_right_record->t) {
-      return hit_left_record;
+  // Anything on the right farther than the left hit cannot be the closest
+  const auto hit_left = left_->intersect_at(r, t_min, t_max);
+  if (!right_) {
+    return hit_left;
+  }
+  const auto hit_right =
+      right_->intersect_at(r, t_min, hit_left ? hit_left->t : t_max);
+  return hit_right ? hit_right : hit_left;
+}
+
+Hit_record BVH_node::surface_at(const Ray& r,
+                                const Intersection& intersection) const
+    noexcept
+{
+  // Intersections always refer to the primitive or instance that was hit
+  assert(&intersection.surface_owner() != this);
+  return intersection.surface_owner().surface_at(r, intersection);
+}
+
+void BVH_node::refit(Thread_pool& pool)
+{
+  // Split the tree into enough independent subtrees to keep the pool busy.
+  // Nodes over primitives only cannot be split and are kept as they are.
+  // Nodes above the subtrees are refitted afterwards, children before
+  // parents.
+  std::vector<BVH_node*> upper_nodes;
+  std::vector<BVH_node*> subtrees;
+  std::deque<BVH_node*> pending{this};
+  while (!pending.empty() &&
+         pending.size() + subtrees.size() < 4 * pool.size()) {
+    const auto node = pending.front();
+    pending.pop_front();
+    auto left = dynamic_cast<BVH_node*>(node->left_);
+    auto right = dynamic_cast<BVH_node*>(node->right_);
+    if (!left && !right) {
+      subtrees.push_back(node);
+      continue;
     }
-    else {
-      return hit_right_record;
+    upper_nodes.push_back(node);
+    for (const auto child : {left, right}) {
+      if (child) {
+        pending.push_back(child);
+      }
     }
   }
-  else if (hit_left_record) {
-    return hit_left_record;
+  subtrees.insert(subtrees.end(), pending.begin(), pending.end());
+
+  pool.parallel_for(subtrees.size(),
+                    [&subtrees](size_t i) { subtrees[i]->refit_subtree(); });
+  for (auto node = upper_nodes.rbegin(); node != upper_nodes.rend(); ++node) {
+    (*node)->refit_node();
   }
-  else if (hit_right_record) {
-    return hit_right_record;
+}
+
+float BVH_node::sah_cost() const noexcept
+{
+  const float area = bounding_box()->surface_area();
+  return area > 0 ? weighted_cost_ / area : 0;
+}
+
+std::vector<Hitable*> BVH_node::primitives() const
+{
+  std::vector<Hitable*> primitives;
+  std::vector<Hitable*> pending{left_, right_};
+  while (!pending.empty()) {
+    const auto child = pending.back();
+    pending.pop_back();
+    if (const auto node = dynamic_cast<const BVH_node*>(child)) {
+      pending.push_back(node->left_);
+      pending.push_back(node->right_);
+    }
+    else if (child) {
+      primitives.push_back(child);
+    }
   }
-  else {
-    return {};
+  return primitives;
+}
+
+// Updates the box and cost of this node from its children
+void BVH_node::refit_node() noexcept
+{
+  assert(left_->bounding_box() != std::nullopt &&
+         (!right_ || right_->bounding_box() != std::nullopt));
+  box0_ = *left_->bounding_box_at(0);
+  box1_ = *left_->bounding_box_at(1);
+  weighted_cost_ = weighted_cost(*left_);
+  if (right_) {
+    box0_ = surrounding_box(box0_, *right_->bounding_box_at(0));
+    box1_ = surrounding_box(box1_, *right_->bounding_box_at(1));
+    weighted_cost_ += weighted_cost(*right_);
   }
+  is_moving_ = box0_ != box1_;
+  weighted_cost_ += traversal_cost * bounding_box()->surface_area();
+}
+
+void BVH_node::refit_subtree() noexcept
+{
+  for (const auto& child : {left_, right_}) {
+    if (const auto node = dynamic_cast<BVH_node*>(child)) {
+      node->refit_subtree();
+    }
+  }
+  refit_node();
+}
+
+bool refit_or_rebuild(BVH_node*& bvh, Arena& arena, Thread_pool& pool,
+                      float max_degradation)
+{
+  bvh->refit(pool);
+  if (bvh->sah_cost() <= max_degradation * bvh->build_sah_cost()) {
+    return false;
+  }
+
+  auto primitives = bvh->primitives();
+  bvh = arena.create<BVH_node>(arena, primitives.begin(), primitives.end());
+  return true;
 }
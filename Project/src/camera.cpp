@@ -0,0 +1,53 @@
+#include "camera.hpp"
+
+void Camera_ray_batch::resize(size_t size)
+{
+  for (auto* values : {&origin_x, &origin_y, &origin_z, &direction_x,
+                       &direction_y, &direction_z, &time}) {
+    values->resize(size);
+  }
+}
+
+void Camera::generate_rays(std::uint64_t seed, const Tile_region& tile,
+                           std::uint64_t sample_index,
+                           Camera_ray_batch& out) const
+{
+  out.resize(tile.pixel_count());
+  out.samplers.clear();
+  out.samplers.reserve(tile.pixel_count());
+
+  const float inv_width = 1.f / tile.image_width;
+  const float inv_height = 1.f / tile.image_height;
+  const float shutter_length = shutter_close_ - shutter_open_;
+
+  size_t i = 0;
+  for (size_t y = tile.y; y < tile.y + tile.height; ++y) {
+    for (size_t x = tile.x; x < tile.x + tile.width; ++x, ++i) {
+      // Same draws in the same order as get_ray callers take them
+      Sampler sampler{seed, y * tile.image_width + x, sample_index};
+      const auto offset = sampler.next_2d();
+      const float time = sampler.next_1d();
+      const auto lens_pos = sampler.next_2d();
+
+      const float u = (x + offset.x) * inv_width;
+      const float v = (y + offset.y) * inv_height;
+      const auto target = lower_left_corner_ + u * horizontal_ + v * vertical_;
+
+      auto origin = origin_;
+      if (lens_radius_ > 0) {
+        const auto lens = concentric_sample_disk(lens_pos);
+        origin += lens_radius_ * (lens.x * u_ + lens.y * v_);
+      }
+      const auto direction = target - origin;
+
+      out.origin_x[i] = origin.x;
+      out.origin_y[i] = origin.y;
+      out.origin_z[i] = origin.z;
+      out.direction_x[i] = direction.x;
+      out.direction_y[i] = direction.y;
+      out.direction_z[i] = direction.z;
+      out.time[i] = shutter_open_ + time * shutter_length;
+      out.samplers.push_back(sampler);
+    }
+  }
+}
@@ -0,0 +1,278 @@
+#include "compressed_bvh.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "arena.hpp"
+#include "bounding_volume_hierarchy.hpp"
+
+namespace {
+constexpr size_t width = Compressed_BVH::width;
+using Node = Compressed_BVH::Node;
+
+// Exponents are limited to those of normal floats
+constexpr int min_exponent = -126;
+constexpr int max_exponent = 127;
+
+// Returns 2^exponent without calling into the math library
+float power_of_two(int exponent) noexcept
+{
+  const auto bits = static_cast<std::uint32_t>(exponent + 127) << 23;
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+// The build and the traversal decode coordinates the same way, so the
+// rounding checked at build time is the rounding seen by rays
+float decode(float origin, float scale, std::uint8_t q) noexcept
+{
+  return origin + static_cast<float>(q) * scale;
+}
+
+// Whether no child of node is a BVH_node
+bool is_leaf(const BVH_node& node) noexcept
+{
+  return !dynamic_cast<const BVH_node*>(node.left()) &&
+         !dynamic_cast<const BVH_node*>(node.right());
+}
+
+// Collapses the top levels of a binary subtree into up to width children.
+// Nodes over primitives only are opened first, since they would otherwise
+// become nodes with few children, then the largest inner node that fits.
+std::vector<const Hitable*> collapse(const BVH_node& node)
+{
+  std::vector<const Hitable*> children{node.left()};
+  if (node.right()) {
+    children.push_back(node.right());
+  }
+
+  while (true) {
+    const BVH_node* best = nullptr;
+    size_t best_index = 0;
+    float best_priority = -1;
+    for (size_t i = 0; i < children.size(); ++i) {
+      const auto inner = dynamic_cast<const BVH_node*>(children[i]);
+      if (!inner || (inner->right() && children.size() == width)) {
+        continue;
+      }
+      const float area = inner->bounding_box()->surface_area();
+      const float priority =
+          is_leaf(*inner) ? std::numeric_limits<float>::max() : area;
+      if (priority > best_priority) {
+        best = inner;
+        best_index = i;
+        best_priority = priority;
+      }
+    }
+    if (!best) {
+      return children;
+    }
+
+    children[best_index] = best->left();
+    if (best->right()) {
+      children.insert(children.begin() + best_index + 1, best->right());
+    }
+  }
+}
+
+struct Builder {
+  std::vector<Node> nodes;
+  std::vector<const Hitable*> primitives;
+  size_t depth = 0; // Longest path from the root, in nodes
+
+  // Appends the compressed subtree of node, which is level nodes below the
+  // root, and returns its index
+  std::uint32_t build(const BVH_node& node, size_t level = 1)
+  {
+    const auto index = static_cast<std::uint32_t>(nodes.size());
+    nodes.emplace_back();
+    depth = std::max(depth, level);
+
+    const auto children = collapse(node);
+    const auto box = *node.bounding_box();
+    Node result{};
+    result.child_count = static_cast<std::uint8_t>(children.size());
+
+    float scale[3];
+    for (int a = 0; a < 3; ++a) {
+      const float low = box.min()[a];
+      const float high = box.max()[a];
+
+      // Smallest power of two spacing whose 255 steps cover the box
+      int exponent = 0;
+      std::frexp((high - low) / 255, &exponent);
+      exponent = std::max(exponent, min_exponent);
+      while (exponent < max_exponent &&
+             decode(low, power_of_two(exponent), 255) < high) {
+        ++exponent;
+      }
+      result.origin[a] = low;
+      result.exponent[a] = static_cast<std::int8_t>(exponent);
+      scale[a] = power_of_two(exponent);
+    }
+
+    for (size_t c = 0; c < children.size(); ++c) {
+      const auto child_box = *children[c]->bounding_box();
+      for (int a = 0; a < 3; ++a) {
+        result.lower[a][c] = quantize_lower(child_box.min()[a],
+                                            result.origin[a], scale[a]);
+        result.upper[a][c] = quantize_upper(child_box.max()[a],
+                                            result.origin[a], scale[a]);
+      }
+
+      if (const auto inner = dynamic_cast<const BVH_node*>(children[c])) {
+        result.children[c] = build(*inner, level + 1);
+      }
+      else {
+        result.children[c] =
+            static_cast<std::uint32_t>(primitives.size()) |
+            Compressed_BVH::leaf_bit;
+        primitives.push_back(children[c]);
+      }
+    }
+
+    // Recursion may have reallocated the array
+    nodes[index] = result;
+    return index;
+  }
+
+  // Rounds down, so that the decoded value is not above value
+  static std::uint8_t quantize_lower(float value, float origin, float scale)
+  {
+    const float steps = std::floor((value - origin) / scale);
+    auto q = static_cast<std::uint8_t>(std::clamp(steps, 0.f, 255.f));
+    while (q > 0 && decode(origin, scale, q) > value) {
+      --q;
+    }
+    return q;
+  }
+
+  // Rounds up, so that the decoded value is not below value
+  static std::uint8_t quantize_upper(float value, float origin, float scale)
+  {
+    const float steps = std::ceil((value - origin) / scale);
+    auto q = static_cast<std::uint8_t>(std::clamp(steps, 0.f, 255.f));
+    while (q < 255 && decode(origin, scale, q) < value) {
+      ++q;
+    }
+    return q;
+  }
+};
+} // anonymous namespace
+
+Compressed_BVH::Compressed_BVH(Arena& arena, const BVH_node& bvh)
+    : box_{*bvh.bounding_box()}
+{
+  Builder builder;
+  builder.build(bvh);
+  assert(builder.primitives.size() < leaf_bit);
+  if (builder.depth > max_depth) {
+    throw std::length_error{"BVH too deep to compress"};
+  }
+
+  node_count_ = builder.nodes.size();
+  primitive_count_ = builder.primitives.size();
+  auto nodes = static_cast<Node*>(
+      arena.allocate(node_count_ * sizeof(Node), alignof(Node)));
+  std::copy(builder.nodes.begin(), builder.nodes.end(), nodes);
+  auto primitives = static_cast<const Hitable**>(arena.allocate(
+      primitive_count_ * sizeof(Hitable*), alignof(Hitable*)));
+  std::copy(builder.primitives.begin(), builder.primitives.end(), primitives);
+  nodes_ = nodes;
+  primitives_ = primitives;
+}
+
+Maybe_intersection_t Compressed_BVH::intersect_at(const Ray& r, float t_min,
+                                                  float t_max) const noexcept
+{
+  if (!box_.hit(r, t_min, t_max)) {
+    return {};
+  }
+
+  const Vec3f inv_direction{1 / r.direction.x, 1 / r.direction.y,
+                            1 / r.direction.z};
+
+  struct Entry {
+    std::uint32_t node;
+    float t; // Where the ray enters the node
+  };
+  // Every level pushes at most width - 1 more entries than it pops
+  Entry stack[(width - 1) * max_depth + 1];
+  size_t size = 0;
+  stack[size++] = Entry{0, t_min};
+
+  Maybe_intersection_t closest;
+  while (size > 0) {
+    const auto entry = stack[--size];
+    if (closest && entry.t > closest->t) {
+      continue;
+    }
+    const Node& node = nodes_[entry.node];
+
+    float scale[3];
+    for (int a = 0; a < 3; ++a) {
+      scale[a] = power_of_two(node.exponent[a]);
+    }
+
+    // Inner children the ray enters, nearest first
+    Entry hits[width];
+    size_t hit_count = 0;
+    for (size_t c = 0; c < node.child_count; ++c) {
+      float t0 = t_min;
+      float t1 = closest ? closest->t : t_max;
+      for (int a = 0; a < 3; ++a) {
+        const float low = decode(node.origin[a], scale[a], node.lower[a][c]);
+        const float high = decode(node.origin[a], scale[a], node.upper[a][c]);
+        float t_low = (low - r.origin[a]) * inv_direction[a];
+        float t_high = (high - r.origin[a]) * inv_direction[a];
+        if (inv_direction[a] < 0) {
+          std::swap(t_low, t_high);
+        }
+        // A NaN from a ray in the plane of a face leaves the interval as is
+        t0 = std::max(t0, t_low);
+        t1 = std::min(t1, t_high);
+      }
+      if (t0 > t1) {
+        continue;
+      }
+
+      const auto child = node.children[c];
+      if (child & leaf_bit) {
+        if (const auto hit = primitives_[child & ~leaf_bit]->intersect_at(
+                r, t_min, closest ? closest->t : t_max)) {
+          closest = hit;
+        }
+        continue;
+      }
+
+      size_t i = hit_count++;
+      for (; i > 0 && hits[i - 1].t > t0; --i) {
+        hits[i] = hits[i - 1];
+      }
+      hits[i] = Entry{child, t0};
+    }
+
+    // The nearest child is popped first
+    assert(size + hit_count <= std::size(stack));
+    while (hit_count > 0) {
+      stack[size++] = hits[--hit_count];
+    }
+  }
+  return closest;
+}
+
+Hit_record Compressed_BVH::surface_at(const Ray& r,
+                                      const Intersection& intersection) const
+    noexcept
+{
+  // Intersections always refer to the primitive or instance that was hit
+  assert(&intersection.surface_owner() != this);
+  return intersection.surface_owner().surface_at(r, intersection);
+}
@@ -0,0 +1,271 @@
+#include "distributed.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "color.hpp"
+#include "image.hpp"
+#include "local_socket.hpp"
+#include "pathtracer.hpp"
+#include "tile.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Both ends run on the same machine, so messages are sent in its byte order
+constexpr std::uint32_t protocol_version = 2;
+
+// Sent by the coordinator once per connection
+struct Session {
+  std::uint32_t version;
+  std::uint32_t reserved;
+  std::uint64_t seed;
+  std::uint64_t width;
+  std::uint64_t height;
+  std::uint64_t sample_per_pixel;
+  std::uint64_t tile_size;
+  std::uint64_t max_depth;
+};
+
+// A range of tiles to render, a tile_count of 0 tells the worker to stop. The
+// worker answers with first_tile, then the colors of every pixel of the
+// range, tile by tile and row by row.
+struct Job {
+  std::uint64_t first_tile;
+  std::uint64_t tile_count;
+};
+
+Tile_rect tile_rect(size_t index, size_t width, size_t height,
+                    size_t tile_size)
+{
+  const size_t tiles_x = (width + tile_size - 1) / tile_size;
+  const size_t x = index % tiles_x * tile_size;
+  const size_t y = index / tiles_x * tile_size;
+  return {x, y, std::min(tile_size, width - x),
+          std::min(tile_size, height - y)};
+}
+
+size_t pixel_count(const Job& job, size_t width, size_t height,
+                   size_t tile_size)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < job.tile_count; ++i) {
+    const auto rect = tile_rect(job.first_tile + i, width, height, tile_size);
+    count += rect.width * rect.height;
+  }
+  return count;
+}
+
+class Coordinator {
+public:
+  Coordinator(const Coordinator_settings& settings, Image& image,
+              size_t sample_per_pixel)
+      : settings_{settings}, image_{image}, sample_per_pixel_{sample_per_pixel}
+  {
+    const auto tile_size = settings.render.tile_size;
+    if (tile_size == 0) {
+      throw std::invalid_argument{"Tile size must be positive"};
+    }
+    const size_t tiles_x = (image.width() + tile_size - 1) / tile_size;
+    const size_t tiles_y = (image.height() + tile_size - 1) / tile_size;
+    remaining_tiles_ = tiles_x * tiles_y;
+    const size_t per_job = std::max<size_t>(settings.tiles_per_job, 1);
+    for (size_t first = 0; first < remaining_tiles_; first += per_job) {
+      pending_.push_back(
+          Job{first, std::min(per_job, remaining_tiles_ - first)});
+    }
+  }
+
+  void run()
+  {
+    const auto listener = Local_socket::listen(settings_.socket_path);
+    auto idle_since = Clock::now();
+    while (true) {
+      {
+        std::lock_guard lock{mutex_};
+        if (remaining_tiles_ == 0) {
+          break;
+        }
+        if (connected_workers_ > 0) {
+          idle_since = Clock::now();
+        }
+        else if (Clock::now() - idle_since >= settings_.worker_timeout) {
+          aborted_ = true;
+          break;
+        }
+      }
+
+      auto connection = listener.accept(std::chrono::milliseconds{100});
+      if (connection.is_open()) {
+        std::lock_guard lock{mutex_};
+        ++connected_workers_;
+        threads_.emplace_back(
+            [this, socket = std::move(connection)] { serve(socket); });
+      }
+    }
+
+    work_changed_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+    std::remove(settings_.socket_path.c_str());
+
+    if (aborted_) {
+      throw std::runtime_error{"No worker connected to " +
+                               settings_.socket_path + " in time"};
+    }
+  }
+
+private:
+  // Hands jobs to one worker until no tile remains or the worker fails
+  void serve(const Local_socket& socket)
+  {
+    socket.set_receive_timeout(settings_.worker_timeout);
+    const auto& render = settings_.render;
+    const Session session{protocol_version, 0,
+                          render.seed,      image_.width(),
+                          image_.height(),  sample_per_pixel_,
+                          render.tile_size, render.max_depth};
+    bool alive = socket.send_value(session);
+
+    std::vector<Color> colors;
+    while (alive) {
+      Job job{};
+      {
+        std::unique_lock lock{mutex_};
+        work_changed_.wait(lock, [this] {
+          return !pending_.empty() || remaining_tiles_ == 0 || aborted_;
+        });
+        if (pending_.empty()) {
+          break;
+        }
+        job = pending_.front();
+        pending_.pop_front();
+      }
+
+      colors.resize(pixel_count(job, image_.width(), image_.height(),
+                                settings_.render.tile_size));
+      std::uint64_t answered_tile = 0;
+      alive = socket.send_value(job) && socket.receive_value(answered_tile) &&
+              answered_tile == job.first_tile &&
+              socket.receive_all(colors.data(),
+                                 colors.size() * sizeof(Color));
+
+      // Jobs do not overlap, so only the bookkeeping needs the lock
+      if (alive) {
+        store(job, colors);
+      }
+      std::lock_guard lock{mutex_};
+      if (alive) {
+        remaining_tiles_ -= job.tile_count;
+      }
+      else {
+        // Another worker takes over the range
+        pending_.push_front(job);
+      }
+      work_changed_.notify_all();
+    }
+
+    if (alive) {
+      socket.send_value(Job{0, 0});
+    }
+    std::lock_guard lock{mutex_};
+    --connected_workers_;
+  }
+
+  void store(const Job& job, const std::vector<Color>& colors)
+  {
+    auto color = colors.begin();
+    for (size_t i = 0; i < job.tile_count; ++i) {
+      const auto rect = tile_rect(job.first_tile + i, image_.width(),
+                                  image_.height(), settings_.render.tile_size);
+      for (size_t y = rect.y; y < rect.y + rect.height; ++y) {
+        std::copy_n(color, rect.width, image_.row(y) + rect.x);
+        color += static_cast<std::ptrdiff_t>(rect.width);
+      }
+    }
+  }
+
+  const Coordinator_settings& settings_;
+  Image& image_;
+  const size_t sample_per_pixel_;
+
+  std::mutex mutex_;
+  std::condition_variable work_changed_;
+  std::deque<Job> pending_;
+  size_t remaining_tiles_ = 0;
+  size_t connected_workers_ = 0;
+  bool aborted_ = false;
+  std::vector<std::thread> threads_;
+};
+
+Local_socket connect_with_retry(const std::string& socket_path,
+                                std::chrono::milliseconds timeout)
+{
+  const auto deadline = Clock::now() + timeout;
+  while (true) {
+    try {
+      return Local_socket::connect(socket_path);
+    }
+    catch (const std::runtime_error&) {
+      if (Clock::now() >= deadline) {
+        throw;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  }
+}
+} // anonymous namespace
+
+void run_coordinator(const Coordinator_settings& settings, Image& image,
+                     size_t sample_per_pixel)
+{
+  Coordinator{settings, image, sample_per_pixel}.run();
+}
+
+bool run_worker(const std::string& socket_path, const Scene& scene,
+                const Camera& camera, size_t thread_count,
+                std::chrono::milliseconds connect_timeout)
+{
+  const auto socket = connect_with_retry(socket_path, connect_timeout);
+
+  Session session{};
+  if (!socket.receive_value(session) || session.version != protocol_version) {
+    return false;
+  }
+  Path_tracer path_tracer{Render_settings{session.seed, thread_count,
+                                          session.tile_size,
+                                          session.max_depth}};
+  const size_t width = session.width, height = session.height;
+
+  std::vector<Color> colors;
+  Job job{};
+  while (socket.receive_value(job)) {
+    if (job.tile_count == 0) {
+      return true;
+    }
+
+    const auto tiles =
+        path_tracer.render_tiles(scene, camera, width, height, job.first_tile,
+                                 job.tile_count, session.sample_per_pixel);
+    colors.clear();
+    for (const auto& tile : tiles) {
+      for (size_t j = 0; j < tile.height(); ++j) {
+        for (size_t i = 0; i < tile.width(); ++i) {
+          colors.push_back(tile.at(i, j));
+        }
+      }
+    }
+    if (!socket.send_value(job.first_tile) ||
+        !socket.send_all(colors.data(), colors.size() * sizeof(Color))) {
+      return false;
+    }
+  }
+  return false;
+}
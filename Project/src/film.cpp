@@ -0,0 +1,169 @@
+#include "film.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <optional>
+
+#include "image.hpp"
+
+namespace {
+constexpr char magic[4] = {'P', 'T', 'F', 'M'};
+constexpr std::uint32_t version = 2;
+
+template <typename T> void write_value(std::ostream& os, T value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T> T read_value(std::istream& is)
+{
+  T value{};
+  is.read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+
+// Returns the size of the pixels of a width x height film in a file, or
+// nothing if it does not fit in a size_t
+std::optional<size_t> pixels_size(size_t width, size_t height)
+{
+  constexpr size_t pixel_size = sizeof(Radiance_sum) + sizeof(std::uint32_t);
+  constexpr size_t max_size = std::numeric_limits<size_t>::max();
+  if (height != 0 && width > max_size / pixel_size / height) {
+    return std::nullopt;
+  }
+  return width * height * pixel_size;
+}
+} // anonymous namespace
+
+Film::Film(size_t width, size_t height, std::uint64_t seed,
+           std::uint32_t first_sample)
+    : width_{width}, height_{height}, seed_{seed},
+      first_sample_{first_sample}, sums_(width * height),
+      sample_counts_(width * height)
+{
+}
+
+std::uint32_t Film::min_sample_count() const
+{
+  if (sample_counts_.empty()) {
+    return 0;
+  }
+  return *std::min_element(sample_counts_.begin(), sample_counts_.end());
+}
+
+void Film::merge(const Film& other)
+{
+  if (other.width_ != width_ || other.height_ != height_ ||
+      other.seed_ != seed_) {
+    throw std::invalid_argument{"Films of different renders cannot merge"};
+  }
+  for (size_t i = 0; i < sums_.size(); ++i) {
+    if (other.sample_counts_[i] != 0 &&
+        other.first_sample_ != first_sample_ + sample_counts_[i]) {
+      throw std::invalid_argument{
+          "Samples of the merged film do not continue the samples of the "
+          "film"};
+    }
+  }
+
+  for (size_t i = 0; i < sums_.size(); ++i) {
+    sums_[i] += other.sums_[i];
+    sample_counts_[i] += other.sample_counts_[i];
+  }
+}
+
+void Film::develop(Image& image) const
+{
+  assert(image.width() == width_ && image.height() == height_);
+  for (size_t y = 0; y < height_; ++y) {
+    Color* row = image.row(y);
+    for (size_t x = 0; x < width_; ++x) {
+      const auto count = sample_counts_[y * width_ + x];
+      row[x] = count == 0 ? Color{} : sums_[y * width_ + x].divided_by(count);
+    }
+  }
+}
+
+void Film::save(const std::string& filename) const
+{
+  const auto temp_filename = filename + ".tmp";
+  {
+    std::ofstream file{temp_filename, std::ios::binary};
+    if (!file) {
+      throw Cannot_write_file{temp_filename.c_str()};
+    }
+
+    file.write(magic, sizeof(magic));
+    write_value(file, version);
+    write_value(file, static_cast<std::uint32_t>(width_));
+    write_value(file, static_cast<std::uint32_t>(height_));
+    write_value(file, seed_);
+    write_value(file, first_sample_);
+
+    static_assert(sizeof(Radiance_sum) == 3 * sizeof(std::int64_t));
+    file.write(reinterpret_cast<const char*>(sums_.data()),
+               static_cast<std::streamsize>(sums_.size() *
+                                            sizeof(Radiance_sum)));
+    file.write(reinterpret_cast<const char*>(sample_counts_.data()),
+               static_cast<std::streamsize>(sample_counts_.size() *
+                                            sizeof(std::uint32_t)));
+    if (!file) {
+      throw Cannot_write_file{temp_filename.c_str()};
+    }
+  }
+
+  // std::rename does not replace an existing file on every platform
+  if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+    std::remove(filename.c_str());
+    if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+      throw Cannot_write_file{filename.c_str()};
+    }
+  }
+}
+
+Film Film::load(const std::string& filename)
+{
+  std::ifstream file{filename, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error{"Cannot open film " + filename};
+  }
+
+  char file_magic[4] = {};
+  file.read(file_magic, sizeof(file_magic));
+  if (!file || std::memcmp(file_magic, magic, sizeof(magic)) != 0 ||
+      read_value<std::uint32_t>(file) != version) {
+    throw std::runtime_error{filename + " is not a film file"};
+  }
+
+  const size_t width = read_value<std::uint32_t>(file);
+  const size_t height = read_value<std::uint32_t>(file);
+  const auto seed = read_value<std::uint64_t>(file);
+  const auto first_sample = read_value<std::uint32_t>(file);
+
+  // The header is not trusted with the size of the allocation: the rest of
+  // the file must hold exactly the pixels it announces
+  const auto header_end = file.tellg();
+  file.seekg(0, std::ios::end);
+  const auto file_end = file.tellg();
+  file.seekg(header_end);
+  const auto size = pixels_size(width, height);
+  if (!file || !size ||
+      static_cast<std::uintmax_t>(file_end - header_end) != *size) {
+    throw std::runtime_error{"Truncated film " + filename};
+  }
+
+  Film film{width, height, seed, first_sample};
+  file.read(reinterpret_cast<char*>(film.sums_.data()),
+            static_cast<std::streamsize>(film.sums_.size() *
+                                         sizeof(Radiance_sum)));
+  file.read(reinterpret_cast<char*>(film.sample_counts_.data()),
+            static_cast<std::streamsize>(film.sample_counts_.size() *
+                                         sizeof(std::uint32_t)));
+  if (!file) {
+    throw std::runtime_error{"Truncated film " + filename};
+  }
+  return film;
+}
@@ -1,11 +1,19 @@
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <regex>
+#include <sstream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
 
 #include "image.hpp"
+#include "thread_pool.hpp"
+#include "tile.hpp"
 
 using byte = unsigned char;
 constexpr byte float_color_to_255(float color)
@@ -13,29 +21,172 @@ constexpr byte float_color_to_255(float color)
   return static_cast<byte>(255.99f * color);
 }
 
-Image::Image(size_t width, size_t height)
-    : width_(width), height_(height), data_(width * height)
+namespace {
+// Rows converted by one task of to_rgb8
+constexpr size_t rows_per_band = 16;
+
+// Gamma 2 encodes a component clamped to [0, 1], NaN becomes 0
+byte encode(float component)
 {
+  return float_color_to_255(
+      std::sqrt(std::min(1.f, std::max(0.f, component))));
 }
 
-void Image::saveto(const std::string& filename) const
+#if defined(__SSE2__)
+// Encodes 16 components at once, with the same result as encode
+void encode16(const float* components, byte* encoded)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1);
+  const __m128 scale = _mm_set1_ps(255.99f);
+  __m128i quarters[4];
+  for (int k = 0; k < 4; ++k) {
+    // maxps returns its second operand when the first is NaN
+    const __m128 clamped = _mm_min_ps(
+        _mm_max_ps(_mm_loadu_ps(components + 4 * k), zero), one);
+    quarters[k] =
+        _mm_cvttps_epi32(_mm_mul_ps(_mm_sqrt_ps(clamped), scale));
+  }
+  const __m128i low = _mm_packs_epi32(quarters[0], quarters[1]);
+  const __m128i high = _mm_packs_epi32(quarters[2], quarters[3]);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(encoded),
+                   _mm_packus_epi16(low, high));
+}
+#endif
+
+void check_extension(const std::string& filename)
 {
   std::regex png{R"(.*\.png$)"};
   if (!std::regex_match(filename, png)) {
     throw Unsupported_image_extension{filename.c_str()};
   }
+}
+
+void write_png(const std::string& filename, const std::vector<byte>& rgb,
+               size_t width, size_t height)
+{
+  if (stbi_write_png(filename.c_str(), width, height, 3,
+                     reinterpret_cast<const void*>(rgb.data()),
+                     width * 3) == 0) {
+    throw Cannot_write_file{filename.c_str()};
+  }
+}
+} // anonymous namespace
+
+Image::Image(size_t width, size_t height)
+    : width_(width), height_(height), data_(width * height)
+{
+}
+
+void Image::saveto(const std::string& filename) const
+{
+  check_extension(filename);
+  write_png(filename, to_rgb8(), width_, height_);
+}
+
+void Image::saveto(const std::string& filename, Thread_pool& pool) const
+{
+  check_extension(filename);
+  write_png(filename, to_rgb8(pool), width_, height_);
+}
+
+void Image::throw_out_of_range(size_t x, size_t y) const
+{
+  std::stringstream ss;
+  ss << "Access image out of index:\n";
+  ss << "Input x:" << x << " y:" << y << "\n";
+  ss << "width:" << width_ << " height:" << height_ << "\n";
+  throw std::out_of_range{ss.str().c_str()};
+}
+
+void Image::blit(const Tile& tile) noexcept
+{
+  assert(tile.startX() + tile.width() <= width_);
+  assert(tile.startY() + tile.height() <= height_);
+  for (size_t j = 0; j < tile.height(); ++j) {
+    std::copy_n(tile.row(j), tile.width(),
+                row(tile.startY() + j) + tile.startX());
+  }
+}
+
+void Image::scale(float factor) noexcept
+{
+  for (auto& color : data_) {
+    color *= factor;
+  }
+}
+
+Image& Image::operator+=(const Image& other)
+{
+  if (other.width_ != width_ || other.height_ != height_) {
+    throw std::invalid_argument{"Cannot add images of different sizes"};
+  }
+  for (size_t i = 0; i < data_.size(); ++i) {
+    data_[i] += other.data_[i];
+  }
+  return *this;
+}
+
+void Image::apply_gamma(float gamma) noexcept
+{
+  const float exponent = 1 / gamma;
+  for (auto& color : data_) {
+    color = Color{std::pow(std::max(0.f, color.r), exponent),
+                  std::pow(std::max(0.f, color.g), exponent),
+                  std::pow(std::max(0.f, color.b), exponent)};
+  }
+}
+
+void Image::tonemap() noexcept
+{
+  for (auto& color : data_) {
+    color = Color{color.r / (1 + color.r), color.g / (1 + color.g),
+                  color.b / (1 + color.b)};
+  }
+}
+
+std::vector<std::uint8_t> Image::to_rgb8() const
+{
+  std::vector<byte> rgb(data_.size() * 3);
+  convert_rows(rgb.data(), 0, height_);
+  return rgb;
+}
+
+std::vector<std::uint8_t> Image::to_rgb8(Thread_pool& pool) const
+{
+  std::vector<byte> rgb(data_.size() * 3);
+  const size_t band_count = (height_ + rows_per_band - 1) / rows_per_band;
+  pool.parallel_for(band_count, [&](size_t band) {
+    convert_rows(rgb.data(), band * rows_per_band,
+                 std::min((band + 1) * rows_per_band, height_));
+  });
+  return rgb;
+}
+
+void Image::convert_rows(std::uint8_t* rgb, size_t first_row,
+                         size_t last_row) const
+{
+  static_assert(sizeof(Color) == 3 * sizeof(float),
+                "The components of a row must be contiguous floats");
+  const size_t row_size = width_ * 3;
+  std::vector<byte> encoded(row_size);
+  for (size_t y = first_row; y < last_row; ++y) {
+    const auto* components = reinterpret_cast<const float*>(row(y));
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= row_size; i += 16) {
+      encode16(components + i, encoded.data() + i);
+    }
+#endif
+    for (; i < row_size; ++i) {
+      encoded[i] = encode(components[i]);
+    }
 
-  std::vector<byte> buffer;
-  buffer.reserve(data_.size() * 3);
-  for (auto i = data_.crbegin(), end = data_.crend(); i != end; ++i) {
-    byte red = float_color_to_255(std::sqrt(i->r));
-    byte green = float_color_to_255(std::sqrt(i->g));
-    byte blue = float_color_to_255(std::sqrt(i->b));
-    // auto color: data_
-    buffer.push_back(red);
-    buffer.push_back(green);
-    buffer.push_back(blue);
+    // The file starts with the last pixel of the image, so rows are stored
+    // from the last one, each from its last pixel
+    byte* out = rgb + (height_ - 1 - y) * row_size;
+    for (size_t x = 0; x < width_; ++x) {
+      std::copy_n(&encoded[(width_ - 1 - x) * 3], 3, out + x * 3);
+    }
   }
-  stbi_write_png(filename.c_str(), width_, height_, 3,
-                 reinterpret_cast<void*>(buffer.data()), width_ * 3);
 }
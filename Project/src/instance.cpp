@@ -0,0 +1,95 @@
+#include "instance.hpp"
+
+#include <cassert>
+
+Instance::Instance(const Hitable& object,
+                   const Transform& object_to_world) noexcept
+    : Instance{object, object_to_world, object_to_world}
+{
+}
+
+Instance::Instance(const Hitable& object, const Transform& start,
+                   const Transform& end) noexcept
+    : object_{&object}
+{
+  set_transform(start, end);
+}
+
+void Instance::set_transform(const Transform& object_to_world) noexcept
+{
+  set_transform(object_to_world, object_to_world);
+}
+
+void Instance::set_transform(const Transform& start,
+                             const Transform& end) noexcept
+{
+  start_ = start;
+  end_ = end;
+  is_moving_ = start_ != end_;
+
+  // Cached since building the top level BVH asks for them many times. Each
+  // point of the object moves on a line, so the boxes at both ends bound the
+  // motion.
+  if (const auto box = object_->bounding_box()) {
+    box0_ = start_(*box);
+    box1_ = end_(*box);
+  }
+  else {
+    box0_ = box1_ = std::nullopt;
+  }
+}
+
+std::optional<AABB> Instance::bounding_box() const noexcept
+{
+  if (!box0_) {
+    return std::nullopt;
+  }
+  return surrounding_box(*box0_, *box1_);
+}
+
+std::optional<AABB> Instance::bounding_box_at(float time) const noexcept
+{
+  if (!box0_) {
+    return std::nullopt;
+  }
+  return is_moving_ ? lerp(*box0_, *box1_, time) : *box0_;
+}
+
+Maybe_intersection_t Instance::intersect_at(const Ray& r, float t_min,
+                                            float t_max) const noexcept
+{
+  // The object space direction keeps its length, so t means the same in both
+  // spaces
+  auto intersection =
+      object_->intersect_at(to_world_at(r.time).inverse()(r), t_min, t_max);
+  if (intersection) {
+    assert(intersection->instance == nullptr);
+    intersection->instance = this;
+  }
+  return intersection;
+}
+
+Hit_record Instance::surface_at(const Ray& r,
+                                const Intersection& intersection) const
+    noexcept
+{
+  const auto to_world = to_world_at(r.time);
+  auto local_intersection = intersection;
+  local_intersection.instance = nullptr;
+  const auto local = local_intersection.surface_owner().surface_at(
+      to_world.inverse()(r), local_intersection);
+
+  return Hit_record{local.t,
+                    to_world(local.point),
+                    normalize(to_world.normal(local.normal)),
+                    local.material,
+                    local.uv,
+                    local.uv_footprint,
+                    to_world(local.dpdu),
+                    to_world(local.dpdv)};
+}
+
+Transform Instance::to_world_at(float time) const noexcept
+{
+  return is_moving_ ? Transform::lerp(start_, end_, time) : start_;
+}
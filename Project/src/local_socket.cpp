@@ -0,0 +1,123 @@
+#include "local_socket.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+sockaddr_un make_address(const std::string& path)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error{"Socket path too long: " + path};
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return address;
+}
+} // anonymous namespace
+
+Local_socket::~Local_socket()
+{
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+Local_socket::Local_socket(Local_socket&& other) noexcept
+    : fd_{std::exchange(other.fd_, -1)}
+{
+}
+
+Local_socket& Local_socket::operator=(Local_socket&& other) noexcept
+{
+  if (this != &other) {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = std::exchange(other.fd_, -1);
+  }
+  return *this;
+}
+
+Local_socket Local_socket::listen(const std::string& path)
+{
+  const auto address = make_address(path);
+  Local_socket result{socket(AF_UNIX, SOCK_STREAM, 0)};
+  if (!result.is_open()) {
+    throw std::runtime_error{"Cannot create a socket"};
+  }
+
+  unlink(path.c_str());
+  if (bind(result.fd_, reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      ::listen(result.fd_, SOMAXCONN) != 0) {
+    throw std::runtime_error{"Cannot listen at " + path};
+  }
+  return result;
+}
+
+Local_socket Local_socket::connect(const std::string& path)
+{
+  const auto address = make_address(path);
+  Local_socket result{socket(AF_UNIX, SOCK_STREAM, 0)};
+  if (!result.is_open() ||
+      ::connect(result.fd_, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    throw std::runtime_error{"Cannot connect to " + path};
+  }
+  return result;
+}
+
+Local_socket Local_socket::accept(std::chrono::milliseconds timeout) const
+{
+  pollfd request{fd_, POLLIN, 0};
+  if (poll(&request, 1, static_cast<int>(timeout.count())) <= 0) {
+    return Local_socket{};
+  }
+  return Local_socket{::accept(fd_, nullptr, nullptr)};
+}
+
+void Local_socket::set_receive_timeout(
+    std::chrono::milliseconds timeout) const noexcept
+{
+  timeval value{};
+  value.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+  value.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+  setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &value, sizeof(value));
+}
+
+bool Local_socket::send_all(const void* data, size_t size) const noexcept
+{
+  auto bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    // A closed peer must fail the send instead of raising SIGPIPE
+    const auto sent = send(fd_, bytes, size, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      return false;
+    }
+    bytes += sent;
+    size -= static_cast<size_t>(sent);
+  }
+  return true;
+}
+
+bool Local_socket::receive_all(void* data, size_t size) const noexcept
+{
+  auto bytes = static_cast<char*>(data);
+  while (size > 0) {
+    const auto received = recv(fd_, bytes, size, 0);
+    if (received <= 0) {
+      return false;
+    }
+    bytes += received;
+    size -= static_cast<size_t>(received);
+  }
+  return true;
+}
@@ -0,0 +1,112 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+Mapped_file::Mapped_file(const std::string& filename)
+{
+  const HANDLE file =
+      CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error{"Cannot open " + filename};
+  }
+
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    throw std::runtime_error{"Cannot read the size of " + filename};
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+  if (size_ == 0) {
+    CloseHandle(file);
+    return;
+  }
+
+  // The view keeps the mapping and the file alive after their handles are
+  // closed
+  const HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    throw std::runtime_error{"Cannot map " + filename};
+  }
+  data_ = static_cast<const std::byte*>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  CloseHandle(mapping);
+  if (data_ == nullptr) {
+    throw std::runtime_error{"Cannot map " + filename};
+  }
+}
+
+void Mapped_file::unmap() noexcept
+{
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+}
+#else
+Mapped_file::Mapped_file(const std::string& filename)
+{
+  const int file = open(filename.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw std::runtime_error{"Cannot open " + filename};
+  }
+
+  struct stat status {};
+  if (fstat(file, &status) != 0) {
+    close(file);
+    throw std::runtime_error{"Cannot read the size of " + filename};
+  }
+  size_ = static_cast<size_t>(status.st_size);
+  if (size_ == 0) {
+    close(file);
+    return;
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error{"Cannot map " + filename};
+  }
+  data_ = static_cast<const std::byte*>(data);
+}
+
+void Mapped_file::unmap() noexcept
+{
+  if (data_) {
+    munmap(const_cast<std::byte*>(data_), size_);
+  }
+}
+#endif
+
+Mapped_file::~Mapped_file() { unmap(); }
+
+Mapped_file::Mapped_file(Mapped_file&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)},
+      size_{std::exchange(other.size_, 0)}
+{
+}
+
+Mapped_file& Mapped_file::operator=(Mapped_file&& other) noexcept
+{
+  if (this != &other) {
+    unmap();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <cmath>
 #include <optional>
-#include <random>
 
+#include "frame.hpp"
 #include "material.hpp"
+#include "sampler.hpp"
+#include "sampling.hpp"
 #include "vector.hpp"
 
 namespace {
@@ -22,21 +26,6 @@ std::optional<Vec3f> refract(Vec3f v, Vec3f n, float ni_over_nt) noexcept
   return std::nullopt;
 }
 
-Vec3f random_in_unit_sphere()
-{
-  // Credit:
-  // https://math.stackexchange.com/questions/87230/picking-random-points-in-the-volume-of-sphere-with-uniform-probability/87238#87238
-  thread_local std::mt19937 gen = std::mt19937{std::random_device{}()};
-  thread_local std::uniform_real_distribution<float> uni(-1, 1);
-  thread_local std::normal_distribution<float> normal(0, 1);
-
-  Vec3f p{normal(gen), normal(gen), normal(gen)};
-  p = normalize(p);
-
-  const auto c = std::cbrt(uni(gen));
-  return p * c;
-}
-
 // Reflectivity by Christophe Schlick
 float schlick(float cosine, float ref_idx)
 {
@@ -45,67 +34,274 @@ float schlick(float cosine, float ref_idx)
   return r0 + (1 - r0) * std::pow(1 - cosine, 5);
 }
 
+// Returns the normal flipped to the side of the surface w is on
+Vec3f facing_normal(Vec3f w, Vec3f normal) noexcept
+{
+  return dot(w, normal) < 0 ? -normal : normal;
+}
+
+// A delta distribution sample that reflects the fraction reflectance of
+// light in direction wi
+Bsdf_sample specular_sample(Vec3f wi, Color reflectance, Vec3f normal) noexcept
+{
+  const float cos_theta = std::abs(dot(wi, normal));
+  return Bsdf_sample{wi, reflectance / std::max(cos_theta, 1e-6f), 1, true};
+}
+
+// Schlick's approximation of the Fresnel reflectance of a conductor
+Color schlick(Color f0, float cosine)
+{
+  const float weight = std::pow(1 - cosine, 5);
+  return f0 + (Color{1, 1, 1} - f0) * weight;
+}
+
 } // namespace
 
-std::optional<Ray> Lambertian::scatter(const Ray& /*ray_in*/,
-                                       const Hit_record& record) const
+std::optional<Bsdf_sample> Lambertian::sample(Vec3f wo,
+                                              const Hit_record& record,
+                                              Sampler& sampler) const
+{
+  const auto normal = facing_normal(wo, record.normal);
+  const auto wi = Frame::from_normal(normal).to_world(
+      cosine_sample_hemisphere(sampler.next_2d()));
+  const float cos_theta = dot(wi, normal);
+  if (cos_theta <= 0) {
+    return std::nullopt;
+  }
+  return Bsdf_sample{wi, albedo(record) / pi,
+                     cosine_hemisphere_pdf(cos_theta)};
+}
+
+Color Lambertian::eval(Vec3f wo, Vec3f wi, const Hit_record& record) const
 {
-  const auto target = record.point + record.normal + random_in_unit_sphere();
-  return Ray{record.point, target - record.point};
+  const auto normal = facing_normal(wo, record.normal);
+  return dot(wi, normal) > 0 ? albedo(record) / pi : Color{};
 }
 
-std::optional<Ray> Metal::scatter(const Ray& ray_in,
-                                  const Hit_record& record) const
+float Lambertian::pdf(Vec3f wo, Vec3f wi, const Hit_record& record) const
 {
-  auto incident_dir = ray_in.direction / ray_in.direction.length();
-  auto reflected = reflect(incident_dir, record.normal) +
-                   fuzzness_ * random_in_unit_sphere();
+  const auto normal = facing_normal(wo, record.normal);
+  return cosine_hemisphere_pdf(std::max(0.f, dot(wi, normal)));
+}
+
+std::optional<Bsdf_sample> Metal::sample(Vec3f wo, const Hit_record& record,
+                                         Sampler& sampler) const
+{
+  const auto u = sampler.next_2d();
+  const auto radius_sample = sampler.next_1d();
+
+  auto reflected = reflect(-wo, record.normal) +
+                   fuzzness_ * uniform_sample_ball(u, radius_sample);
   if (dot(reflected, record.normal) <= 0) {
     return std::nullopt;
   }
 
-  Ray scattered{record.point, reflected};
-  return scattered;
+  const auto wi = normalize(reflected);
+  return specular_sample(wi, albedo(record), record.normal);
 }
 
-std::optional<Ray> Dielectric::scatter(const Ray& ray_in,
-                                       const Hit_record& record) const
+std::optional<Bsdf_sample> Dielectric::sample(Vec3f wo,
+                                              const Hit_record& record,
+                                              Sampler& sampler) const
 {
+  const auto incident_dir = -wo;
+
   Vec3f out_normal;
   float ni_over_nt;
   float cosine;
-  if (dot(ray_in.direction, record.normal) > 0) {
+  if (dot(incident_dir, record.normal) > 0) {
     out_normal = -record.normal;
     ni_over_nt = refractive_index_;
-    cosine = refractive_index_ * dot(ray_in.direction, record.normal) /
-             ray_in.direction.length();
+    cosine = refractive_index_ * dot(incident_dir, record.normal);
   }
   else {
     out_normal = record.normal;
     ni_over_nt = 1 / refractive_index_;
-    cosine = -dot(ray_in.direction, record.normal) / ray_in.direction.length();
+    cosine = -dot(incident_dir, record.normal);
   }
 
   float reflection_prob = 1;
 
-  auto refraction = refract(ray_in.direction, out_normal, ni_over_nt);
+  auto refraction = refract(incident_dir, out_normal, ni_over_nt);
   if (refraction) {
     reflection_prob = schlick(cosine, refractive_index_);
   }
 
-  static std::uniform_real_distribution<float> dis(0, 1);
-  thread_local std::mt19937 gen = std::mt19937{std::random_device{}()};
+  if (sampler.next_1d() < reflection_prob) {
+    const auto reflection = reflect(incident_dir, record.normal);
+    return specular_sample(reflection, albedo(record), record.normal);
+  }
+  return specular_sample(normalize(*refraction), albedo(record),
+                         record.normal);
+}
+
+std::optional<Bsdf_sample> Conductor::sample(Vec3f wo,
+                                             const Hit_record& record,
+                                             Sampler& sampler) const
+{
+  const auto frame = Frame::from_normal(facing_normal(wo, record.normal));
+  const auto wo_local = frame.to_local(wo);
+  if (wo_local.z <= 0) {
+    return std::nullopt;
+  }
+
+  const auto m = distribution_.sample_visible(wo_local, sampler.next_2d());
+  const auto wi_local = reflect(-wo_local, m);
+  if (wi_local.z <= 0) {
+    return std::nullopt;
+  }
+
+  const float cos_o_m = dot(wo_local, m);
+  const auto f = schlick(albedo(record), cos_o_m) *
+                 (distribution_.d(m) * distribution_.g(wo_local, wi_local) /
+                  (4 * wo_local.z * wi_local.z));
+  const float pdf = distribution_.visible_pdf(wo_local, m) / (4 * cos_o_m);
+  return Bsdf_sample{frame.to_world(wi_local), f, pdf};
+}
+
+Color Conductor::eval(Vec3f wo, Vec3f wi, const Hit_record& record) const
+{
+  const auto frame = Frame::from_normal(facing_normal(wo, record.normal));
+  const auto wo_local = frame.to_local(wo);
+  const auto wi_local = frame.to_local(wi);
+  if (wo_local.z <= 0 || wi_local.z <= 0) {
+    return Color{};
+  }
+
+  const auto m = normalize(wo_local + wi_local);
+  return schlick(albedo(record), dot(wo_local, m)) *
+         (distribution_.d(m) * distribution_.g(wo_local, wi_local) /
+          (4 * wo_local.z * wi_local.z));
+}
+
+float Conductor::pdf(Vec3f wo, Vec3f wi, const Hit_record& record) const
+{
+  const auto frame = Frame::from_normal(facing_normal(wo, record.normal));
+  const auto wo_local = frame.to_local(wo);
+  const auto wi_local = frame.to_local(wi);
+  if (wo_local.z <= 0 || wi_local.z <= 0) {
+    return 0;
+  }
+
+  const auto m = normalize(wo_local + wi_local);
+  return distribution_.visible_pdf(wo_local, m) / (4 * dot(wo_local, m));
+}
 
-  if (dis(gen) < reflection_prob) {
-    auto incident_dir = ray_in.direction / ray_in.direction.length();
-    auto reflection = reflect(incident_dir, record.normal);
-    return Ray(record.point, reflection);
+std::optional<Bsdf_sample> Rough_dielectric::sample(Vec3f wo,
+                                                    const Hit_record& record,
+                                                    Sampler& sampler) const
+{
+  const auto frame = Frame::from_normal(record.normal);
+  const auto wo_local = frame.to_local(wo);
+  if (wo_local.z == 0) {
+    return std::nullopt;
   }
-  return Ray(record.point, *refraction);
+
+  const auto m = distribution_.sample_visible(wo_local, sampler.next_2d());
+  const float cos_o_m = dot(wo_local, m);
+  const float reflectance = fresnel_dielectric(cos_o_m, refractive_index_);
+  const float visible_pdf = distribution_.visible_pdf(wo_local, m);
+
+  if (sampler.next_1d() < reflectance) {
+    const auto wi_local = reflect(-wo_local, m);
+    if (wi_local.z * wo_local.z <= 0) {
+      return std::nullopt;
+    }
+
+    const auto f = albedo(record) * (distribution_.d(m) *
+                                     distribution_.g(wo_local, wi_local) *
+                                     reflectance /
+                                     std::abs(4 * wi_local.z * wo_local.z));
+    const float pdf = visible_pdf / (4 * std::abs(cos_o_m)) * reflectance;
+    return Bsdf_sample{frame.to_world(wi_local), f, pdf};
+  }
+
+  // Relative refractive index across the boundary, seen from wo
+  const float eta = cos_o_m > 0 ? refractive_index_ : 1 / refractive_index_;
+  const auto wi_local = refract(-wo_local, cos_o_m > 0 ? m : -m, 1 / eta);
+  if (!wi_local || wi_local->z * wo_local.z >= 0) {
+    return std::nullopt;
+  }
+
+  const float cos_i_m = dot(*wi_local, m);
+  const float denom = (cos_i_m + cos_o_m / eta) * (cos_i_m + cos_o_m / eta);
+  const float transmittance = 1 - reflectance;
+  const auto f =
+      albedo(record) *
+      (transmittance * distribution_.d(m) *
+       distribution_.g(wo_local, *wi_local) *
+       std::abs(cos_i_m * cos_o_m / (wi_local->z * wo_local.z * denom)) /
+       (eta * eta));
+  const float pdf = visible_pdf * std::abs(cos_i_m) / denom * transmittance;
+  return Bsdf_sample{frame.to_world(*wi_local), f, pdf};
+}
+
+Color Rough_dielectric::eval(Vec3f wo, Vec3f wi,
+                             const Hit_record& record) const
+{
+  const auto frame = Frame::from_normal(record.normal);
+  return evaluate(frame.to_local(wo), frame.to_local(wi), albedo(record)).f;
+}
+
+float Rough_dielectric::pdf(Vec3f wo, Vec3f wi, const Hit_record& record) const
+{
+  const auto frame = Frame::from_normal(record.normal);
+  // The density does not depend on the tint
+  return evaluate(frame.to_local(wo), frame.to_local(wi), Color{}).pdf;
+}
+
+// Value and density of the BSDF for a pair of local directions
+Bsdf_sample Rough_dielectric::evaluate(Vec3f wo, Vec3f wi,
+                                       Color tint) const noexcept
+{
+  const float cos_o = wo.z, cos_i = wi.z;
+  if (cos_o == 0 || cos_i == 0) {
+    return Bsdf_sample{wi};
+  }
+
+  // Recover the microfacet normal from the generalized half vector
+  const bool is_reflection = cos_i * cos_o > 0;
+  const float eta =
+      is_reflection ? 1
+                    : (cos_o > 0 ? refractive_index_ : 1 / refractive_index_);
+  auto m = wi * eta + wo;
+  if (m.length_square() == 0) {
+    return Bsdf_sample{wi};
+  }
+  m = normalize(m);
+  if (m.z < 0) {
+    m = -m;
+  }
+
+  // Microfacets seen from their back side do not contribute
+  const float cos_i_m = dot(wi, m), cos_o_m = dot(wo, m);
+  if (cos_i_m * cos_i < 0 || cos_o_m * cos_o < 0) {
+    return Bsdf_sample{wi};
+  }
+
+  const float reflectance = fresnel_dielectric(cos_o_m, refractive_index_);
+  const float d = distribution_.d(m);
+  const float g = distribution_.g(wo, wi);
+  const float visible_pdf = distribution_.visible_pdf(wo, m);
+
+  if (is_reflection) {
+    const float f = d * g * reflectance / std::abs(4 * cos_i * cos_o);
+    const float pdf = visible_pdf / (4 * std::abs(cos_o_m)) * reflectance;
+    return Bsdf_sample{wi, tint * f, pdf};
+  }
+
+  const float denom = (cos_i_m + cos_o_m / eta) * (cos_i_m + cos_o_m / eta);
+  const float transmittance = 1 - reflectance;
+  const float f = transmittance * d * g *
+                  std::abs(cos_i_m * cos_o_m / (cos_i * cos_o * denom)) /
+                  (eta * eta);
+  const float pdf = visible_pdf * std::abs(cos_i_m) / denom * transmittance;
+  return Bsdf_sample{wi, tint * f, pdf};
 }
 
-std::optional<Ray> Emission::scatter(const Ray& /*ray_in*/,
-                                     const Hit_record& /*record*/) const
+std::optional<Bsdf_sample> Emission::sample(Vec3f /*wo*/,
+                                            const Hit_record& /*record*/,
+                                            Sampler& /*sampler*/) const
 {
   return {};
 }
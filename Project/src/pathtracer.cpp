@@ -1,22 +1,32 @@
 #include "pathtracer.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <future>
 #include <iostream>
 #include <memory>
-#include <random>
+#include <mutex>
+#include <stdexcept>
 
 #include "camera.hpp"
 #include "color.hpp"
+#include "film.hpp"
 #include "image.hpp"
 #include "material.hpp"
 #include "ray.hpp"
+#include "sampler.hpp"
 #include "scene.hpp"
 #include "tile.hpp"
+#include "tile_schedule.hpp"
+#include "tiled_image_file.hpp"
 
-Color trace(const Scene& scene, const Ray& ray, size_t depth = 0) noexcept
+// Materials may read image textures, whose tiles are loaded on first use. A
+// texture file that can no longer be read throws, and the error leaves run
+// once the workers are idle.
+Color trace(const Scene& scene, const Ray& ray, Sampler& sampler,
+            size_t max_depth, size_t depth = 0)
 {
-  constexpr size_t max_depth = 100;
-
   // depth exceed some threshold
   if (depth >= max_depth) {
     return Color{}; // return black
@@ -24,10 +34,15 @@ Color trace(const Scene& scene, const Ray& ray, size_t depth = 0) noexcept
 
   if (auto hit = scene.intersect_at(ray)) {
     auto material = hit->material;
-    auto ref = material->scatter(ray, *hit);
     const auto emitted = material->emitted();
-    if (ref) {
-      return emitted + material->albedo() * trace(scene, *ref, depth + 1);
+    const auto wo = -normalize(ray.direction);
+    const auto bsdf = material->sample(wo, *hit, sampler);
+    if (bsdf && bsdf->pdf > 0) {
+      const auto weight =
+          bsdf->f * (std::abs(dot(bsdf->wi, hit->normal)) / bsdf->pdf);
+      const Ray scattered{hit->point, bsdf->wi, ray.time};
+      return emitted +
+             weight * trace(scene, scattered, sampler, max_depth, depth + 1);
     }
     return emitted;
   }
@@ -42,76 +57,464 @@ struct PixelData {
   Color c;
 };
 
-constexpr size_t tile_size = 32;
-Path_tracer::Path_tracer()
+Path_tracer::Path_tracer(const Render_settings& settings)
+    : settings_{settings}, pool_{settings.thread_count}
+{
+  if (settings.tile_size == 0) {
+    throw std::invalid_argument{"Tile size must be positive"};
+  }
+}
+
+void Path_tracer::set_progress_callback(Progress_callback callback)
+{
+  progress_callback_ = std::move(callback);
+}
+
+void Path_tracer::set_cancellation_token(Cancellation_token token)
+{
+  cancellation_ = std::move(token);
+}
+
+namespace {
+constexpr size_t samples_per_pass = 16;
+
+void check_cancellation(const Cancellation_token& token)
+{
+  if (token.is_cancelled()) {
+    throw Render_cancelled{};
+  }
+}
+
+// Counts the finished tiles of a render and passes the progress to the
+// callback, one call at a time
+class Progress_reporter {
+public:
+  // total_samples is the number of samples of the whole render, a render
+  // against a deadline also measures its progress in time
+  Progress_reporter(
+      const Progress_callback& callback, double total_samples,
+      Render_clock::time_point deadline = Render_clock::time_point::max())
+      : callback_{callback}, total_samples_{total_samples},
+        deadline_{deadline}, start_{Render_clock::now()}
+  {
+  }
+
+  void tile_done(size_t sample_count)
+  {
+    if (!callback_) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++progress_.tiles_done;
+    progress_.samples_done += sample_count;
+    const auto now = Render_clock::now();
+    progress_.elapsed = now - start_;
+
+    double fraction =
+        total_samples_ > 0
+            ? static_cast<double>(progress_.samples_done) / total_samples_
+            : 1;
+    if (deadline_ != Render_clock::time_point::max()) {
+      const std::chrono::duration<double> budget = deadline_ - start_;
+      fraction = budget.count() > 0
+                     ? std::max(fraction, progress_.elapsed / budget)
+                     : 1;
+    }
+    progress_.fraction = static_cast<float>(std::min(fraction, 1.));
+    callback_(progress_);
+  }
+
+private:
+  const Progress_callback& callback_;
+  double total_samples_;
+  Render_clock::time_point deadline_;
+  Render_clock::time_point start_;
+  std::mutex mutex_;
+  Render_progress progress_;
+};
+
+// Every random number of a sample is derived from (seed, pixel, sample), so
+// the result does not depend on scheduling. The path continues with the
+// sampler the camera drew the ray from.
+Color trace_sample(const Scene& scene, const Camera_ray_batch& rays, size_t i,
+                   size_t max_depth)
+{
+  Sampler sampler = rays.samplers[i];
+  return trace(scene, rays.ray(i), sampler, max_depth);
+}
+
+// Renders the pixels of rect into pixels, which points to the first pixel of
+// rect in a buffer whose rows are stride pixels apart
+void render_tile(const Scene& scene, const Camera& camera,
+                 const Render_settings& settings, const Tile_rect& rect,
+                 size_t width, size_t height, size_t sample_per_pixel,
+                 Color* pixels, size_t stride)
+{
+  const auto seed = settings.seed;
+  const size_t x = rect.x, y = rect.y;
+  const size_t end_x = x + rect.width, end_y = y + rect.height;
+  assert(x < end_x && y < end_y && end_x <= width && end_y <= height);
+  assert(stride >= rect.width);
+  const Tile_region region{x, y, rect.width, rect.height, width, height};
+
+  for (size_t j = 0; j < rect.height; ++j) {
+    std::fill_n(pixels + j * stride, rect.width, Color{});
+  }
+
+  // Camera rays are generated a whole tile at a time, one sample after
+  // another. Every pixel still sums its samples in order.
+  Camera_ray_batch rays;
+  for (size_t sample = 0; sample < sample_per_pixel; ++sample) {
+    camera.generate_rays(seed, region, sample, rays);
+    size_t i = 0;
+    for (size_t py = y; py < end_y; ++py) {
+      Color* row = pixels + (py - y) * stride;
+      for (size_t px = x; px < end_x; ++px, ++i) {
+        row[px - x] += trace_sample(scene, rays, i, settings.max_depth);
+      }
+    }
+  }
+
+  for (size_t j = 0; j < rect.height; ++j) {
+    Color* row = pixels + j * stride;
+    for (size_t i = 0; i < rect.width; ++i) {
+      row[i] /= static_cast<float>(sample_per_pixel);
+    }
+  }
+}
+
+Tile render_tile(const Scene& scene, const Camera& camera,
+                 const Render_settings& settings, const Tile_rect& rect,
+                 size_t width, size_t height, size_t sample_per_pixel)
+{
+  Tile tile{rect.x, rect.y, rect.width, rect.height};
+  render_tile(scene, camera, settings, rect, width, height, sample_per_pixel,
+              &tile.at(0, 0), rect.width);
+  return tile;
+}
+
+// Takes samples of every pixel of a tile until it has sample_end samples,
+// returns the number of samples taken
+size_t accumulate_tile(const Scene& scene, const Camera& camera,
+                       const Render_settings& settings, Film& film,
+                       const Tile_rect& rect, size_t sample_end)
+{
+  const size_t width = film.width(), height = film.height();
+  const size_t x = rect.x, y = rect.y;
+  const size_t end_x = x + rect.width, end_y = y + rect.height;
+  assert(x < end_x && y < end_y && end_x <= width && end_y <= height);
+  const Tile_region region{x, y, rect.width, rect.height, width, height};
+
+  // Samples are numbered per pixel, so a resumed render continues with
+  // exactly the samples the interrupted one would have taken
+  std::vector<size_t> sample_begins(region.pixel_count());
+  size_t first_sample = sample_end;
+  {
+    size_t i = 0;
+    for (size_t py = y; py < end_y; ++py) {
+      for (size_t px = x; px < end_x; ++px, ++i) {
+        sample_begins[i] = film.first_sample() + film.sample_count_at(px, py);
+        first_sample = std::min(first_sample, sample_begins[i]);
+      }
+    }
+  }
+
+  std::vector<Radiance_sum> sums(region.pixel_count());
+  Camera_ray_batch rays;
+  for (size_t sample = first_sample; sample < sample_end; ++sample) {
+    camera.generate_rays(film.seed(), region, sample, rays);
+    size_t i = 0;
+    for (size_t py = y; py < end_y; ++py) {
+      for (size_t px = x; px < end_x; ++px, ++i) {
+        if (sample >= sample_begins[i]) {
+          sums[i] += trace_sample(scene, rays, i, settings.max_depth);
+        }
+      }
+    }
+  }
+
+  size_t sample_count = 0;
+  size_t i = 0;
+  for (size_t py = y; py < end_y; ++py) {
+    for (size_t px = x; px < end_x; ++px, ++i) {
+      if (sample_begins[i] < sample_end) {
+        film.add_samples(
+            px, py, sums[i],
+            static_cast<std::uint32_t>(sample_end - sample_begins[i]));
+        sample_count += sample_end - sample_begins[i];
+      }
+    }
+  }
+  return sample_count;
+}
+
+// Calls render with every tile of queue, on every worker of pool
+template <typename F>
+void render_queue(Thread_pool& pool, Tile_queue& queue, F render)
 {
-  progress_bar_.set_bar_width(50);
-  progress_bar_.start_bar_with("[");
-  progress_bar_.fill_bar_progress_with("=");
-  progress_bar_.lead_bar_progress_with(">");
-  progress_bar_.fill_bar_remainder_with(" ");
-  progress_bar_.end_bar_with("]");
-  progress_bar_.set_postfix_text("Rendering");
-  progress_bar_.set_foreground_color(indicators::Color::GREEN);
+  pool.parallel_for(pool.size(), [&](size_t) {
+    while (const auto tile = queue.pop()) {
+      render(*tile);
+    }
+  });
 }
+} // anonymous namespace
 
 void Path_tracer::run(const Scene& scene, const Camera& camera, Image& image,
                       size_t sample_per_pixel)
 {
   const auto width = image.width(), height = image.height();
+  Progress_reporter progress{progress_callback_,
+                             static_cast<double>(width * height) *
+                                 static_cast<double>(sample_per_pixel)};
+
+  // Tiles do not overlap, so every worker renders straight into the pixels
+  // of its tile, and a finished tile is in the image at once
+  Tile_queue queue{ordered_tiles(width, height, settings_.tile_size,
+                                 settings_.tile_order),
+                   pool_.size()};
+  render_queue(pool_, queue, [&](const Tile_rect& rect) {
+    if (cancellation_.is_cancelled()) {
+      return;
+    }
+    render_tile(scene, camera, settings_, rect, width, height,
+                sample_per_pixel, image.row(rect.y) + rect.x, width);
+    progress.tile_done(rect.width * rect.height * sample_per_pixel);
+  });
+  check_cancellation(cancellation_);
+}
 
-  std::vector<std::future<Tile>> results;
-
-  std::atomic<std::size_t> progress_tick = 0;
-  const std::size_t tile_count = height * width / tile_size / tile_size + 1;
-
-  for (size_t y = 0; y < height; y += tile_size) {
-    for (size_t x = 0; x < width; x += tile_size) {
-      results.push_back(
-          std::async(std::launch::async, [this, &progress_tick, tile_count, x,
-                                          y, sample_per_pixel, width, height,
-                                          &scene, &camera] {
-            const size_t end_x = std::min(x + tile_size, width);
-            const size_t end_y = std::min(y + tile_size, height);
-            assert(x < end_x && y < end_y);
-            Tile tile{x, y, end_x - x, end_y - y};
-
-            for (size_t j = 0; j < tile.height(); ++j) {
-              for (size_t i = 0; i < tile.width(); ++i) {
-
-                Color c;
-                thread_local std::mt19937 gen =
-                    std::mt19937{std::random_device{}()};
-                std::uniform_real_distribution<float> dis(0.0, 1.0);
-                for (size_t sample = 0; sample < sample_per_pixel; ++sample) {
-                  const float u = (x + i + dis(gen)) / width;
-                  const float v = (y + j + dis(gen)) / height;
-
-                  const auto r = camera.get_ray(Camera_sample{{u, v}});
-                  c += trace(scene, r);
-                }
-                c /= static_cast<float>(sample_per_pixel);
-                tile.at(i, j) = c;
-              }
-            }
-
-            ++progress_tick;
-            progress_bar_.set_progress(
-                static_cast<float>(progress_tick.load()) / tile_count * 100.);
-
-            return tile;
-          }));
-    }
-  }
-
-  for (auto& result : results) {
-    result.wait();
-    const auto tile = result.get();
-
-    for (size_t j = 0; j < tile.height(); ++j) {
-      for (size_t i = 0; i < tile.width(); ++i) {
-        image.color_at(tile.startX() + i, tile.startY() + j) = tile.at(i, j);
+void Path_tracer::run(const Scene& scene, const std::vector<Render_job>& jobs)
+{
+  // Round robin over the views, so that the tiles of every view are spread
+  // over the whole queue
+  std::vector<std::vector<Tile_rect>> tiles_of_job(jobs.size());
+  size_t tile_count = 0;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    const auto& image = jobs[i].image;
+    tiles_of_job[i] = ordered_tiles(image.width(), image.height(),
+                                    settings_.tile_size, settings_.tile_order);
+    for (auto& tile : tiles_of_job[i]) {
+      tile.frame = i;
+    }
+    tile_count += tiles_of_job[i].size();
+  }
+  std::vector<Tile_rect> tiles;
+  tiles.reserve(tile_count);
+  for (size_t k = 0; tiles.size() < tile_count; ++k) {
+    for (const auto& job_tiles : tiles_of_job) {
+      if (k < job_tiles.size()) {
+        tiles.push_back(job_tiles[k]);
       }
     }
   }
+
+  double total_samples = 0;
+  for (const auto& job : jobs) {
+    total_samples += static_cast<double>(job.image.width() *
+                                         job.image.height()) *
+                     static_cast<double>(job.sample_per_pixel);
+  }
+  Progress_reporter progress{progress_callback_, total_samples};
+  Tile_queue queue{tiles, pool_.size()};
+  render_queue(pool_, queue, [&](const Tile_rect& rect) {
+    if (cancellation_.is_cancelled()) {
+      return;
+    }
+    // Tiles do not overlap, so workers never write the same pixel
+    const auto& job = jobs[rect.frame];
+    auto& image = job.image;
+    render_tile(scene, job.camera, settings_, rect, image.width(),
+                image.height(), job.sample_per_pixel,
+                image.row(rect.y) + rect.x, image.width());
+    progress.tile_done(rect.width * rect.height * job.sample_per_pixel);
+  });
+  check_cancellation(cancellation_);
+}
+
+void Path_tracer::run(const Scene& scene, const Camera& camera,
+                      Tiled_image_writer& writer, size_t sample_per_pixel)
+{
+  const auto tile_size = settings_.tile_size;
+  assert(writer.tile_size() >= tile_size);
+  const auto width = writer.width(), height = writer.height();
+  Progress_reporter progress{progress_callback_,
+                             static_cast<double>(width * height) *
+                                 static_cast<double>(sample_per_pixel)};
+
+  // Every finished tile goes straight to the file and is released, so only
+  // one tile per worker is alive at any time
+  Tile_queue queue{
+      ordered_tiles(width, height, tile_size, settings_.tile_order),
+      pool_.size()};
+  render_queue(pool_, queue, [&](const Tile_rect& rect) {
+    if (cancellation_.is_cancelled()) {
+      return;
+    }
+    const auto tile = render_tile(scene, camera, settings_, rect, width,
+                                  height, sample_per_pixel);
+    writer.write(tile);
+    progress.tile_done(tile.width() * tile.height() * sample_per_pixel);
+  });
+  check_cancellation(cancellation_);
+}
+
+std::vector<Tile> Path_tracer::render_tiles(const Scene& scene,
+                                            const Camera& camera, size_t width,
+                                            size_t height, size_t first_tile,
+                                            size_t tile_count,
+                                            size_t sample_per_pixel)
+{
+  // Tiles are numbered in the order the coordinator hands them out, which
+  // does not depend on settings().tile_order
+  const auto frame_tiles = ordered_tiles(width, height, settings_.tile_size,
+                                         Tile_order::row_major);
+  assert(first_tile + tile_count <= frame_tiles.size());
+
+  double pixel_count = 0;
+  for (size_t index = first_tile; index < first_tile + tile_count; ++index) {
+    pixel_count += static_cast<double>(frame_tiles[index].width *
+                                       frame_tiles[index].height);
+  }
+  Progress_reporter progress{
+      progress_callback_,
+      pixel_count * static_cast<double>(sample_per_pixel)};
+
+  std::vector<Tile> tiles(tile_count);
+  pool_.parallel_for(tile_count, [&](size_t index) {
+    if (cancellation_.is_cancelled()) {
+      return;
+    }
+    tiles[index] = render_tile(scene, camera, settings_,
+                               frame_tiles[first_tile + index], width, height,
+                               sample_per_pixel);
+    progress.tile_done(tiles[index].width() * tiles[index].height() *
+                       sample_per_pixel);
+  });
+  check_cancellation(cancellation_);
+  return tiles;
+}
+
+void Path_tracer::run(const Scene& scene, const Camera& camera, Film& film,
+                      size_t sample_end,
+                      const Checkpoint_settings& checkpoint)
+{
+  render_passes(scene, camera, film, sample_end,
+                Render_clock::time_point::max(), checkpoint);
+}
+
+size_t Path_tracer::run(const Scene& scene, const Camera& camera,
+                        Image& image, Render_clock::time_point deadline,
+                        size_t max_sample_per_pixel)
+{
+  Film film(image.width(), image.height(), settings_.seed);
+  const auto sample_per_pixel =
+      render_passes(scene, camera, film, max_sample_per_pixel, deadline, {});
+  film.develop(image);
+  return sample_per_pixel;
+}
+
+size_t Path_tracer::render_passes(const Scene& scene, const Camera& camera,
+                                  Film& film, size_t sample_end,
+                                  Render_clock::time_point deadline,
+                                  const Checkpoint_settings& checkpoint)
+{
+  using Clock = Render_clock;
+  const auto tiles = ordered_tiles(film.width(), film.height(),
+                                   settings_.tile_size, settings_.tile_order);
+
+  const size_t first_sample = film.first_sample() + film.min_sample_count();
+  const bool has_deadline = deadline != Clock::time_point::max();
+
+  double total_samples = 0;
+  for (size_t y = 0; y < film.height(); ++y) {
+    for (size_t x = 0; x < film.width(); ++x) {
+      const size_t begin = film.first_sample() + film.sample_count_at(x, y);
+      if (begin < sample_end) {
+        total_samples += static_cast<double>(sample_end - begin);
+      }
+    }
+  }
+  Progress_reporter progress{progress_callback_, total_samples, deadline};
+
+  std::future<void> pending_checkpoint;
+  auto last_checkpoint = Clock::now();
+  const auto save_checkpoint = [&] {
+    if (pending_checkpoint.valid()) {
+      pending_checkpoint.get();
+    }
+    // The copy is taken between passes, the file is written while the next
+    // pass renders
+    pending_checkpoint =
+        std::async(std::launch::async,
+                   [snapshot = film, filename = checkpoint.filename] {
+                     snapshot.save(filename);
+                   });
+    last_checkpoint = Clock::now();
+  };
+
+  // Against a deadline, passes start at one sample per pixel and double, so
+  // that a first image arrives early and the duration of a sample is known
+  // before larger passes are started
+  size_t pass_begin = first_sample;
+  size_t pass_size = has_deadline ? 1 : samples_per_pass;
+  Clock::duration sample_duration{};
+  std::atomic<bool> cut_short = false;
+  while (pass_begin < sample_end && !cut_short &&
+         !cancellation_.is_cancelled()) {
+    const auto pass_start = Clock::now();
+    if (pass_begin > first_sample && has_deadline) {
+      // Shrinks the pass to what the last one predicts fits before the
+      // deadline, and stops if not even one sample does
+      const auto remaining = deadline - pass_start;
+      if (remaining <= Clock::duration::zero()) {
+        break;
+      }
+      const auto fitting =
+          sample_duration.count() > 0
+              ? static_cast<size_t>(remaining / sample_duration)
+              : pass_size;
+      if (fitting == 0) {
+        break;
+      }
+      pass_size = std::min(pass_size, fitting);
+    }
+    const size_t pass_end = std::min(pass_begin + pass_size, sample_end);
+
+    Tile_queue queue{tiles, pool_.size()};
+    render_queue(pool_, queue, [&](const Tile_rect& rect) {
+      // Tiles are not started after the deadline, so a pass the prediction
+      // missed ends early, and only gave some of the tiles its samples
+      if (has_deadline && Clock::now() >= deadline) {
+        cut_short = true;
+        return;
+      }
+      if (cancellation_.is_cancelled()) {
+        return;
+      }
+      progress.tile_done(
+          accumulate_tile(scene, camera, settings_, film, rect, pass_end));
+    });
+    if (cancellation_.is_cancelled()) {
+      // The film only has some tiles of the pass, it is not checkpointed
+      break;
+    }
+
+    sample_duration =
+        (Clock::now() - pass_start) / static_cast<int>(pass_end - pass_begin);
+    pass_begin = pass_end;
+    pass_size = std::min(pass_size * 2, samples_per_pass);
+
+    if (!checkpoint.filename.empty() &&
+        (pass_begin >= sample_end || cut_short ||
+         Clock::now() - last_checkpoint >= checkpoint.interval)) {
+      save_checkpoint();
+    }
+  }
+
+  if (pending_checkpoint.valid()) {
+    pending_checkpoint.get();
+  }
+  check_cancellation(cancellation_);
+  return film.first_sample() + film.min_sample_count();
 }
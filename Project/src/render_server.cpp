@@ -0,0 +1,234 @@
+#include "render_server.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+#include "angle.hpp"
+#include "camera.hpp"
+#include "image.hpp"
+#include "local_socket.hpp"
+
+namespace {
+// Both ends run on the same machine, so messages are sent in its byte order
+enum class Message : std::uint32_t { render = 1, stop = 2 };
+
+// Longer strings are refused, so a broken client cannot make the server
+// allocate without bound
+constexpr std::uint32_t max_string_size = 4096;
+
+// Larger frames are refused for the same reason: the image is allocated
+// before the render starts. The sample count bounds how long a request may
+// keep the server busy.
+constexpr std::uint64_t max_image_side = 1 << 16;
+constexpr std::uint64_t max_pixel_count = std::uint64_t{1} << 28;
+constexpr std::uint64_t max_sample_per_pixel = 1 << 20;
+
+// A client that stops sending in the middle of a request is dropped after
+// this time, so it cannot block the requests after it
+constexpr std::chrono::seconds receive_timeout{10};
+
+// The fixed size part of a render request, its strings follow it
+struct Request_values {
+  std::uint64_t width;
+  std::uint64_t height;
+  std::uint64_t sample_per_pixel;
+  float position[3];
+  float lookat[3];
+  float up[3];
+  float fov;
+  float aperture;
+  float focus_distance;
+};
+
+bool send_string(const Local_socket& socket, const std::string& s)
+{
+  return socket.send_value(static_cast<std::uint32_t>(s.size())) &&
+         socket.send_all(s.data(), s.size());
+}
+
+bool receive_string(const Local_socket& socket, std::string& s)
+{
+  std::uint32_t size = 0;
+  if (!socket.receive_value(size) || size > max_string_size) {
+    return false;
+  }
+  s.resize(size);
+  return socket.receive_all(s.data(), size);
+}
+
+bool send_request(const Local_socket& socket, const Render_request& request)
+{
+  const auto& p = request.position;
+  const auto& l = request.lookat;
+  const auto& u = request.up;
+  const Request_values values{request.width,
+                              request.height,
+                              request.sample_per_pixel,
+                              {p.x, p.y, p.z},
+                              {l.x, l.y, l.z},
+                              {u.x, u.y, u.z},
+                              request.fov,
+                              request.aperture,
+                              request.focus_distance};
+  return socket.send_value(Message::render) && socket.send_value(values) &&
+         send_string(socket, request.scene) &&
+         send_string(socket, request.output);
+}
+
+// Whether the frame of a request is small enough to allocate
+bool valid_frame(const Request_values& v)
+{
+  // Checked by division, so a product that wraps around is refused too
+  return v.width <= max_image_side && v.height <= max_image_side &&
+         (v.height == 0 || v.width <= max_pixel_count / v.height) &&
+         v.sample_per_pixel <= max_sample_per_pixel;
+}
+
+bool receive_request(const Local_socket& socket, Render_request& request)
+{
+  Request_values v{};
+  // The whole request is read before it is checked, a connection closed
+  // with data left unread would be reset before the client gets the reply
+  if (!socket.receive_value(v) || !receive_string(socket, request.scene) ||
+      !receive_string(socket, request.output) || !valid_frame(v)) {
+    return false;
+  }
+  request.width = v.width;
+  request.height = v.height;
+  request.sample_per_pixel = v.sample_per_pixel;
+  request.position = Point3f{v.position[0], v.position[1], v.position[2]};
+  request.lookat = Point3f{v.lookat[0], v.lookat[1], v.lookat[2]};
+  request.up = Vec3f{v.up[0], v.up[1], v.up[2]};
+  request.fov = v.fov;
+  request.aperture = v.aperture;
+  request.focus_distance = v.focus_distance;
+  return true;
+}
+
+bool send_reply(const Local_socket& socket, const Render_reply& reply)
+{
+  return socket.send_value(static_cast<std::uint32_t>(reply.ok)) &&
+         send_string(socket, reply.message);
+}
+
+Render_reply receive_reply(const Local_socket& socket)
+{
+  std::uint32_t ok = 0;
+  Render_reply reply;
+  if (!socket.receive_value(ok) || !receive_string(socket, reply.message)) {
+    throw std::runtime_error{"Lost the connection to the render server"};
+  }
+  reply.ok = ok != 0;
+  return reply;
+}
+} // anonymous namespace
+
+Render_server::Render_server(Scene_loader loader, size_t scene_capacity,
+                             const Render_settings& settings)
+    : loader_{std::move(loader)},
+      scene_capacity_{std::max<size_t>(scene_capacity, 1)},
+      path_tracer_{settings}
+{
+}
+
+void Render_server::serve(const std::string& socket_path)
+{
+  const auto listener = Local_socket::listen(socket_path);
+  while (true) {
+    const auto client = listener.accept(std::chrono::seconds{1});
+    if (!client.is_open()) {
+      continue;
+    }
+    client.set_receive_timeout(receive_timeout);
+
+    Message message{};
+    if (!client.receive_value(message)) {
+      continue;
+    }
+    if (message == Message::stop) {
+      send_reply(client, Render_reply{true, {}});
+      break;
+    }
+
+    Render_request request;
+    if (message != Message::render || !receive_request(client, request)) {
+      send_reply(client, Render_reply{false, "Malformed request"});
+      continue;
+    }
+
+    Render_reply reply{true, {}};
+    try {
+      if (request.width == 0 || request.height == 0) {
+        throw std::invalid_argument{"Empty image"};
+      }
+      Image image(request.width, request.height);
+      render(request, image);
+      image.saveto(request.output, path_tracer_.thread_pool());
+    }
+    catch (const std::exception& e) {
+      reply = Render_reply{false, e.what()};
+    }
+    send_reply(client, reply);
+  }
+  std::remove(socket_path.c_str());
+}
+
+void Render_server::render(const Render_request& request, Image& image)
+{
+  const auto aspect_ratio =
+      static_cast<float>(request.width) / static_cast<float>(request.height);
+  const Camera camera{request.position,
+                      request.lookat,
+                      request.up,
+                      Degree{request.fov},
+                      aspect_ratio,
+                      0,
+                      0,
+                      request.aperture,
+                      request.focus_distance};
+  path_tracer_.run(scene(request.scene), camera, image,
+                   request.sample_per_pixel);
+}
+
+const Scene& Render_server::scene(const std::string& name)
+{
+  const auto found = scenes_.find(name);
+  if (found != scenes_.end()) {
+    ++scene_hits_;
+    lru_.splice(lru_.begin(), lru_, found->second);
+    return lru_.front().second;
+  }
+
+  // A loader that throws leaves the cache as it was
+  ++scene_misses_;
+  auto scene = loader_(name);
+  lru_.emplace_front(name, std::move(scene));
+  scenes_[name] = lru_.begin();
+  while (lru_.size() > scene_capacity_) {
+    scenes_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  return lru_.front().second;
+}
+
+Render_reply send_render_request(const std::string& socket_path,
+                                 const Render_request& request)
+{
+  const auto socket = Local_socket::connect(socket_path);
+  if (!send_request(socket, request)) {
+    throw std::runtime_error{"Lost the connection to the render server"};
+  }
+  return receive_reply(socket);
+}
+
+void send_stop_request(const std::string& socket_path)
+{
+  const auto socket = Local_socket::connect(socket_path);
+  if (!socket.send_value(Message::stop)) {
+    throw std::runtime_error{"Lost the connection to the render server"};
+  }
+  receive_reply(socket);
+}
@@ -11,6 +11,12 @@
 Maybe_hit_t Scene::intersect_at(const Ray& r) const noexcept
 {
   assert(aggregate_ != nullptr);
-  return aggregate_->intersect_at(r, 0.001f,
-                                  std::numeric_limits<float>::infinity());
+  const auto intersection = aggregate_->intersect_at(
+      r, 0.001f, std::numeric_limits<float>::infinity());
+  if (!intersection) {
+    return std::nullopt;
+  }
+
+  // Only the closest hit pays for computing its surface data
+  return intersection->surface_owner().surface_at(r, *intersection);
 }
@@ -0,0 +1,294 @@
+#include "scene_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "arena.hpp"
+#include "axis_aligned_rect.hpp"
+#include "compressed_bvh.hpp"
+#include "image.hpp"
+#include "sphere.hpp"
+
+namespace {
+constexpr char magic[4] = {'P', 'T', 'S', 'C'};
+constexpr std::uint32_t version = 2;
+
+// Reads differently on a machine of the other byte order
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+struct Header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint32_t node_size; // Detects a different layout of the nodes
+  std::uint64_t key;
+  std::uint64_t node_count;
+  std::uint64_t primitive_count;
+  float box[6];
+};
+static_assert(sizeof(Header) == 64);
+
+enum class Primitive_type : std::uint32_t { sphere, rect_xy, rect_xz, rect_yz };
+
+struct Primitive_record {
+  Primitive_type type;
+  std::uint32_t material;
+  float values[8];
+  std::uint32_t source; // Index in the primitive list of the scene
+};
+
+using Material_indices = std::unordered_map<const Material*, std::uint32_t>;
+
+Material_indices index_materials(const std::vector<const Material*>& palette)
+{
+  Material_indices indices;
+  for (size_t i = 0; i < palette.size(); ++i) {
+    indices.emplace(palette[i], static_cast<std::uint32_t>(i));
+  }
+  return indices;
+}
+
+std::uint32_t material_index(const Material* material,
+                             const Material_indices& indices)
+{
+  const auto found = indices.find(material);
+  if (found == indices.end()) {
+    throw std::invalid_argument{"Material missing from the palette"};
+  }
+  return found->second;
+}
+
+// Records are zero initialized, so unused values and the source do not
+// change the key
+Primitive_record to_record(const Hitable& primitive,
+                           const Material_indices& indices)
+{
+  Primitive_record record{};
+  if (const auto sphere = dynamic_cast<const Sphere*>(&primitive)) {
+    record.type = Primitive_type::sphere;
+    record.material = material_index(sphere->material, indices);
+    const float values[] = {sphere->center.x, sphere->center.y,
+                            sphere->center.z, sphere->motion.x,
+                            sphere->motion.y, sphere->motion.z,
+                            sphere->radius};
+    std::memcpy(record.values, values, sizeof(values));
+    return record;
+  }
+
+  const auto set_rect = [&](Primitive_type type, const auto& rect,
+                            float offset) {
+    record.type = type;
+    record.material = material_index(rect.material, indices);
+    const float values[] = {
+        rect.min.x, rect.min.y, rect.max.x, rect.max.y, offset,
+        rect.direction == Normal_Direction::Negetive ? 1.f : 0.f};
+    std::memcpy(record.values, values, sizeof(values));
+  };
+  if (const auto rect = dynamic_cast<const Rect_XY*>(&primitive)) {
+    set_rect(Primitive_type::rect_xy, *rect, rect->z);
+  }
+  else if (const auto rect = dynamic_cast<const Rect_XZ*>(&primitive)) {
+    set_rect(Primitive_type::rect_xz, *rect, rect->y);
+  }
+  else if (const auto rect = dynamic_cast<const Rect_YZ*>(&primitive)) {
+    set_rect(Primitive_type::rect_yz, *rect, rect->x);
+  }
+  else {
+    throw std::invalid_argument{"Primitive cannot be stored in a cache"};
+  }
+  return record;
+}
+
+// 64 bit FNV-1a
+std::uint64_t hash_bytes(const void* data, size_t size, std::uint64_t hash)
+{
+  const auto bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// Whether the nodes of a file form a tree whose children are all in range,
+// no deeper than a Compressed_BVH may be. The build stores every node before
+// its children, so requiring that also rules out cycles.
+bool valid_nodes(const Compressed_BVH::Node* nodes, size_t node_count,
+                 size_t primitive_count)
+{
+  // Longest path from the root to each node, in nodes
+  std::vector<size_t> depths(node_count, 1);
+  for (size_t i = 0; i < node_count; ++i) {
+    const auto& node = nodes[i];
+    if (node.child_count == 0 || node.child_count > Compressed_BVH::width) {
+      return false;
+    }
+    for (size_t c = 0; c < node.child_count; ++c) {
+      const auto child = node.children[c];
+      if (child & Compressed_BVH::leaf_bit) {
+        if ((child & ~Compressed_BVH::leaf_bit) >= primitive_count) {
+          return false;
+        }
+      }
+      else if (child <= i || child >= node_count ||
+               depths[i] == Compressed_BVH::max_depth) {
+        return false;
+      }
+      else {
+        depths[child] = std::max(depths[child], depths[i] + 1);
+      }
+    }
+  }
+  return true;
+}
+} // anonymous namespace
+
+std::uint64_t scene_content_key(const std::vector<Hitable*>& primitives,
+                                const std::vector<const Material*>& palette)
+{
+  const auto indices = index_materials(palette);
+  auto key = hash_bytes(&version, sizeof(version), 0xcbf29ce484222325ull);
+  for (const auto primitive : primitives) {
+    const auto record = to_record(*primitive, indices);
+    key = hash_bytes(&record, sizeof(record), key);
+  }
+  return key;
+}
+
+void write_scene_cache(const std::string& filename, std::uint64_t key,
+                       const Compressed_BVH& bvh,
+                       const std::vector<Hitable*>& primitives,
+                       const std::vector<const Material*>& palette)
+{
+  const auto indices = index_materials(palette);
+  std::unordered_map<const Hitable*, std::uint32_t> sources;
+  for (size_t i = 0; i < primitives.size(); ++i) {
+    sources.emplace(primitives[i], static_cast<std::uint32_t>(i));
+  }
+
+  std::vector<Primitive_record> records;
+  records.reserve(bvh.primitive_count());
+  for (size_t i = 0; i < bvh.primitive_count(); ++i) {
+    const auto primitive = bvh.primitives()[i];
+    const auto source = sources.find(primitive);
+    if (source == sources.end()) {
+      throw std::invalid_argument{"Primitive missing from the scene"};
+    }
+    records.push_back(to_record(*primitive, indices));
+    records.back().source = source->second;
+  }
+
+  Header header{};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.byte_order = byte_order_mark;
+  header.node_size = sizeof(Compressed_BVH::Node);
+  header.key = key;
+  header.node_count = bvh.node_count();
+  header.primitive_count = records.size();
+  const auto box = *bvh.bounding_box();
+  for (int a = 0; a < 3; ++a) {
+    header.box[a] = box.min()[a];
+    header.box[3 + a] = box.max()[a];
+  }
+
+  const auto temp_filename = filename + ".tmp";
+  {
+    std::ofstream file{temp_filename, std::ios::binary};
+    if (!file) {
+      throw Cannot_write_file{temp_filename.c_str()};
+    }
+
+    // Nodes follow the 64 byte header, so they are aligned in the mapping
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(bvh.nodes()),
+               static_cast<std::streamsize>(bvh.node_count() *
+                                            sizeof(Compressed_BVH::Node)));
+    file.write(reinterpret_cast<const char*>(records.data()),
+               static_cast<std::streamsize>(records.size() *
+                                            sizeof(Primitive_record)));
+    if (!file) {
+      throw Cannot_write_file{temp_filename.c_str()};
+    }
+  }
+
+  // std::rename does not replace an existing file on every platform
+  if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+    std::remove(filename.c_str());
+    if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+      throw Cannot_write_file{filename.c_str()};
+    }
+  }
+}
+
+std::optional<Cached_aggregate>
+load_scene_cache(const std::string& filename, std::uint64_t key, Arena& arena,
+                 const std::vector<Hitable*>& primitives,
+                 const std::vector<const Material*>& palette)
+{
+  Mapped_file file;
+  try {
+    file = Mapped_file{filename};
+  }
+  catch (const std::runtime_error&) {
+    return std::nullopt;
+  }
+
+  Header header{};
+  if (file.size() < sizeof(header)) {
+    return std::nullopt;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+      header.version != version || header.byte_order != byte_order_mark ||
+      header.node_size != sizeof(Compressed_BVH::Node) || header.key != key) {
+    return std::nullopt;
+  }
+
+  using Node = Compressed_BVH::Node;
+  const size_t nodes_end = sizeof(header) + header.node_count * sizeof(Node);
+  const size_t records_end =
+      nodes_end + header.primitive_count * sizeof(Primitive_record);
+  if (header.node_count == 0 || header.node_count > file.size() ||
+      header.primitive_count > file.size() || file.size() != records_end) {
+    return std::nullopt;
+  }
+
+  const auto nodes =
+      reinterpret_cast<const Node*>(file.data() + sizeof(header));
+  if (header.primitive_count >= Compressed_BVH::leaf_bit ||
+      !valid_nodes(nodes, header.node_count, header.primitive_count)) {
+    return std::nullopt;
+  }
+
+  // The leaves refer to the primitives of the scene, each record tells which
+  // one and must describe it exactly
+  const auto indices = index_materials(palette);
+  const auto records =
+      reinterpret_cast<const Primitive_record*>(file.data() + nodes_end);
+  auto leaves = static_cast<const Hitable**>(arena.allocate(
+      header.primitive_count * sizeof(Hitable*), alignof(Hitable*)));
+  for (size_t i = 0; i < header.primitive_count; ++i) {
+    Primitive_record record;
+    std::memcpy(&record, &records[i], sizeof(record));
+    if (record.source >= primitives.size()) {
+      return std::nullopt;
+    }
+    const auto primitive = primitives[record.source];
+    auto expected = to_record(*primitive, indices);
+    expected.source = record.source;
+    if (std::memcmp(&expected, &record, sizeof(record)) != 0) {
+      return std::nullopt;
+    }
+    leaves[i] = primitive;
+  }
+
+  const AABB box{{header.box[0], header.box[1], header.box[2]},
+                 {header.box[3], header.box[4], header.box[5]}};
+  const auto aggregate = arena.create<Compressed_BVH>(
+      box, nodes, header.node_count, leaves, header.primitive_count);
+  return Cached_aggregate{std::move(file), aggregate};
+}
@@ -1,18 +1,25 @@
-#include <utility>
+#include <algorithm>
+#include <cmath>
 
 #include "ray.hpp"
 #include "sphere.hpp"
 
 std::optional<AABB> Sphere::bounding_box() const noexcept
+{
+  return surrounding_box(*bounding_box_at(0), *bounding_box_at(1));
+}
+
+std::optional<AABB> Sphere::bounding_box_at(float time) const noexcept
 {
   const Vec3f offset(radius, radius, radius);
-  return AABB{center - offset, center + offset};
+  const auto c = center_at(time);
+  return AABB{c - offset, c + offset};
 }
 
-Maybe_hit_t Sphere::intersect_at(const Ray& r, float t_min, float t_max) const
-    noexcept
+Maybe_intersection_t Sphere::intersect_at(const Ray& r, float t_min,
+                                          float t_max) const noexcept
 {
-  const auto oc = r.origin - center;
+  const auto oc = r.origin - center_at(r.time);
 
   const auto a = dot(r.direction, r.direction);
   const auto b = 2 * dot(r.direction, oc);
@@ -27,20 +34,35 @@ Maybe_hit_t Sphere::intersect_at(const Ray& r, float t_min, float t_max) const
   const auto t1 = (-b - sqrt_delta) / (2 * a);
   const auto t2 = (-b + sqrt_delta) / (2 * a);
 
-  auto hit_record_from_t = [&r, this](float t) {
-    const auto point = r.point_at_parameter(t);
-    const auto normal = (point - center) / radius;
-
-    Hit_record record{t, point, normal, material};
-    return std::optional<Hit_record>{std::in_place, record};
-  };
-
   // Get the smaller non-negative value of t1, t2
   if (t1 >= t_min && t1 < t_max) {
-    return hit_record_from_t(t1);
+    return Intersection{t1, this};
   }
   if (t2 >= t_min && t2 < t_max) {
-    return hit_record_from_t(t2);
+    return Intersection{t2, this};
   }
   return std::nullopt;
 }
+
+Hit_record Sphere::surface_at(const Ray& r,
+                              const Intersection& intersection) const noexcept
+{
+  const auto point = r.point_at_parameter(intersection.t);
+  const auto normal = (point - center_at(r.time)) / radius;
+
+  // Longitude and latitude, with v = 0 at the bottom pole
+  const float phi = std::atan2(-normal.z, normal.x) + pi;
+  const float theta = std::acos(std::clamp(-normal.y, -1.f, 1.f));
+  const Point2f uv{phi / (2 * pi), theta / pi};
+
+  const float sin_theta = std::sin(theta), cos_theta = std::cos(theta);
+  const float sin_phi = std::sin(phi), cos_phi = std::cos(phi);
+  const Vec3f dpdu =
+      2 * pi * radius * Vec3f{sin_phi * sin_theta, 0, cos_phi * sin_theta};
+  const Vec3f dpdv =
+      pi * radius *
+      Vec3f{-cos_phi * cos_theta, sin_theta, sin_phi * cos_theta};
+
+  return Hit_record{intersection.t, point, normal, material, uv, 0, dpdu,
+                    dpdv};
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "texture.hpp"
+#include "texture_cache.hpp"
+
+namespace {
+// Wraps a texel coordinate into [0, size)
+size_t repeat(long long coordinate, size_t size)
+{
+  const auto n = static_cast<long long>(size);
+  return static_cast<size_t>(((coordinate % n) + n) % n);
+}
+
+Color lerp(Color a, Color b, float t)
+{
+  return a * (1 - t) + b * t;
+}
+} // anonymous namespace
+
+Color Constant_texture::value(const Hit_record& /*record*/) const
+{
+  return color_;
+}
+
+Color Checker_texture::value(const Hit_record& record) const
+{
+  const auto u = static_cast<long long>(std::floor(record.uv.x * frequency_));
+  const auto v = static_cast<long long>(std::floor(record.uv.y * frequency_));
+  return (u + v) % 2 == 0 ? even_->value(record) : odd_->value(record);
+}
+
+Image_texture::Image_texture(Texture_cache& cache, std::string filename)
+    : cache_{&cache}, id_{cache.add(std::move(filename))}
+{
+}
+
+Color Image_texture::value(const Hit_record& record) const
+{
+  const auto size = cache_->size(id_, 0);
+  const float max_level = static_cast<float>(cache_->level_count(id_) - 1);
+
+  // Pick the level whose texels are about as wide as the footprint
+  const float width =
+      record.uv_footprint * static_cast<float>(std::max(size[0], size[1]));
+  const float level =
+      width > 1 ? std::min(std::log2(width), max_level) : 0.f;
+
+  const auto lower = static_cast<size_t>(level);
+  const float t = level - static_cast<float>(lower);
+  if (t == 0) {
+    return bilinear(lower, record.uv);
+  }
+  return lerp(bilinear(lower, record.uv), bilinear(lower + 1, record.uv), t);
+}
+
+Color Image_texture::bilinear(size_t level, Point2f uv) const
+{
+  const auto [width, height] = cache_->size(id_, level);
+
+  // Texel centers are at half-integer coordinates
+  const float s = uv.x * static_cast<float>(width) - 0.5f;
+  const float t = uv.y * static_cast<float>(height) - 0.5f;
+  const float s0 = std::floor(s), t0 = std::floor(t);
+  const float ds = s - s0, dt = t - t0;
+
+  const auto x0 = repeat(static_cast<long long>(s0), width);
+  const auto x1 = repeat(static_cast<long long>(s0) + 1, width);
+  const auto y0 = repeat(static_cast<long long>(t0), height);
+  const auto y1 = repeat(static_cast<long long>(t0) + 1, height);
+
+  const auto bottom = lerp(cache_->texel(id_, level, x0, y0),
+                           cache_->texel(id_, level, x1, y0), ds);
+  const auto top = lerp(cache_->texel(id_, level, x0, y1),
+                        cache_->texel(id_, level, x1, y1), ds);
+  return lerp(bottom, top, dt);
+}
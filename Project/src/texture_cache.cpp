@@ -0,0 +1,336 @@
+#include "texture_cache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+[[noreturn]] void throw_bad_file(const std::string& filename,
+                                 const std::string& reason)
+{
+  throw std::runtime_error{"Cannot read texture " + filename + ": " + reason};
+}
+
+// Reads a whitespace separated header token, skipping comments. The single
+// whitespace character after the token is consumed as well.
+std::string read_token(std::istream& is)
+{
+  std::string token;
+  for (int c = is.get(); c != std::char_traits<char>::eof(); c = is.get()) {
+    if (c == '#' && token.empty()) {
+      is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    else if (std::isspace(c)) {
+      if (!token.empty()) {
+        break;
+      }
+    }
+    else {
+      token.push_back(static_cast<char>(c));
+    }
+  }
+  return token;
+}
+
+size_t read_size(std::istream& is, const std::string& filename)
+{
+  const auto token = read_token(is);
+  if (token.empty() ||
+      !std::all_of(token.begin(), token.end(),
+                   [](unsigned char c) { return std::isdigit(c); })) {
+    throw_bad_file(filename, "invalid header");
+  }
+  return std::stoul(token);
+}
+
+float decode_float(const unsigned char* bytes, bool is_big_endian)
+{
+  std::uint32_t bits = 0;
+  for (int i = 0; i < 4; ++i) {
+    const auto byte = bytes[is_big_endian ? i : 3 - i];
+    bits = (bits << 8u) | byte;
+  }
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+} // anonymous namespace
+
+size_t Texture_cache::Tile_key_hash::operator()(const Tile_key& key) const
+    noexcept
+{
+  std::uint64_t h = key.texture;
+  h = h * 0x9E3779B97F4A7C15ull + key.level;
+  h = h * 0x9E3779B97F4A7C15ull + key.x;
+  h = h * 0x9E3779B97F4A7C15ull + key.y;
+  return static_cast<size_t>(h ^ (h >> 32u));
+}
+
+Texture_cache::Texture_cache(size_t memory_budget)
+    : memory_budget_{memory_budget}
+{
+}
+
+size_t Texture_cache::add(std::string filename)
+{
+  // Read the header without holding the lock
+  auto image = read_header(filename);
+  std::lock_guard<std::mutex> lock{mutex_};
+  files_.push_back(std::move(image));
+  return files_.size() - 1;
+}
+
+std::array<size_t, 2> Texture_cache::size(size_t texture, size_t level)
+{
+  const auto& image = file(texture);
+  assert(level < image.level_sizes.size());
+  return image.level_sizes[level];
+}
+
+size_t Texture_cache::level_count(size_t texture)
+{
+  return file(texture).level_sizes.size();
+}
+
+Color Texture_cache::texel(size_t texture, size_t level, size_t x, size_t y)
+{
+  const Tile_key key{static_cast<std::uint32_t>(texture),
+                     static_cast<std::uint32_t>(level),
+                     static_cast<std::uint32_t>(x / tile_size),
+                     static_cast<std::uint32_t>(y / tile_size)};
+  const auto found = tile(key);
+  return found->texels[(y % tile_size) * found->width + x % tile_size];
+}
+
+size_t Texture_cache::memory_used() const
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  return memory_used_;
+}
+
+size_t Texture_cache::hits() const
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  return hits_;
+}
+
+size_t Texture_cache::misses() const
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  return misses_;
+}
+
+const Texture_cache::Image_file& Texture_cache::file(size_t texture) const
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  assert(texture < files_.size());
+  return *files_[texture];
+}
+
+std::unique_ptr<const Texture_cache::Image_file>
+Texture_cache::read_header(const std::string& filename)
+{
+  std::ifstream is{filename, std::ios::binary};
+  if (!is) {
+    throw_bad_file(filename, "cannot open file");
+  }
+
+  auto image = std::make_unique<Image_file>();
+  image->filename = filename;
+  const auto magic = read_token(is);
+  if (magic == "P6" || magic == "P5") {
+    image->channels = magic == "P6" ? 3 : 1;
+  }
+  else if (magic == "PF" || magic == "Pf") {
+    image->channels = magic == "PF" ? 3 : 1;
+    image->is_float = true;
+  }
+  else {
+    throw_bad_file(filename, "not a binary PPM, PGM or PFM file");
+  }
+
+  const size_t width = read_size(is, filename);
+  const size_t height = read_size(is, filename);
+  if (width == 0 || height == 0) {
+    throw_bad_file(filename, "empty image");
+  }
+
+  if (image->is_float) {
+    // The sign of the scale gives the byte order of the samples
+    const auto token = read_token(is);
+    char* end = nullptr;
+    const float scale = std::strtof(token.c_str(), &end);
+    if (token.empty() || *end != '\0' || scale == 0) {
+      throw_bad_file(filename, "invalid header");
+    }
+    image->is_big_endian = scale > 0;
+  }
+  else {
+    const size_t max_value = read_size(is, filename);
+    if (max_value == 0 || max_value > 255) {
+      throw_bad_file(filename, "only 8 bit images are supported");
+    }
+    image->scale = 1.f / static_cast<float>(max_value);
+  }
+
+  image->data_offset = is.tellg();
+  const auto sample_bytes = static_cast<std::streamoff>(
+      width * height * image->channels * (image->is_float ? 4 : 1));
+  is.seekg(0, std::ios::end);
+  if (!is || is.tellg() < image->data_offset + sample_bytes) {
+    throw_bad_file(filename, "truncated pixel data");
+  }
+
+  image->level_sizes.push_back({width, height});
+  while (image->level_sizes.back()[0] > 1 ||
+         image->level_sizes.back()[1] > 1) {
+    const auto [w, h] = image->level_sizes.back();
+    image->level_sizes.push_back({std::max<size_t>(1, w / 2),
+                                  std::max<size_t>(1, h / 2)});
+  }
+  return image;
+}
+
+Texture_cache::Tile_ptr Texture_cache::tile(const Tile_key& key)
+{
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    const auto found = tiles_.find(key);
+    if (found != tiles_.end()) {
+      lru_.splice(lru_.begin(), lru_, found->second);
+      ++hits_;
+      return found->second->second;
+    }
+    ++misses_;
+  }
+
+  // Loading may take long or recurse into coarser levels, so it is done
+  // without the lock. Two threads may then build the same tile, in which case
+  // the second one is dropped.
+  const auto& image = file(key.texture);
+  auto created = std::make_shared<const Tile>(
+      key.level == 0 ? load_tile(image, key) : filter_tile(image, key));
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  const auto found = tiles_.find(key);
+  if (found != tiles_.end()) {
+    lru_.splice(lru_.begin(), lru_, found->second);
+    return found->second->second;
+  }
+
+  lru_.emplace_front(key, created);
+  tiles_.emplace(key, lru_.begin());
+  memory_used_ += created->texels.size() * sizeof(Color);
+
+  while (memory_used_ > memory_budget_ && lru_.size() > 1) {
+    const auto& [evicted_key, evicted] = lru_.back();
+    memory_used_ -= evicted->texels.size() * sizeof(Color);
+    tiles_.erase(evicted_key);
+    lru_.pop_back();
+  }
+  return created;
+}
+
+Texture_cache::Tile Texture_cache::load_tile(const Image_file& image,
+                                             const Tile_key& key) const
+{
+  const auto [width, height] = image.level_sizes[0];
+  const size_t x0 = key.x * tile_size, y0 = key.y * tile_size;
+  assert(x0 < width && y0 < height);
+
+  Tile loaded;
+  loaded.width = std::min(tile_size, width - x0);
+  loaded.height = std::min(tile_size, height - y0);
+  loaded.texels.resize(loaded.width * loaded.height);
+
+  std::ifstream is{image.filename, std::ios::binary};
+  if (!is) {
+    throw_bad_file(image.filename, "cannot open file");
+  }
+
+  const size_t channel_bytes = image.is_float ? 4 : 1;
+  const size_t pixel_bytes = image.channels * channel_bytes;
+  std::vector<unsigned char> row(loaded.width * pixel_bytes);
+  for (size_t j = 0; j < loaded.height; ++j) {
+    // PFM rows are stored bottom to top, PPM rows top to bottom
+    const size_t y = y0 + j;
+    const size_t file_row = image.is_float ? y : height - 1 - y;
+    is.seekg(image.data_offset +
+             static_cast<std::streamoff>((file_row * width + x0) *
+                                         pixel_bytes));
+    is.read(reinterpret_cast<char*>(row.data()),
+            static_cast<std::streamsize>(row.size()));
+    if (!is) {
+      throw_bad_file(image.filename, "truncated pixel data");
+    }
+
+    for (size_t i = 0; i < loaded.width; ++i) {
+      float rgb[3]{};
+      for (size_t c = 0; c < image.channels; ++c) {
+        const auto* sample = &row[i * pixel_bytes + c * channel_bytes];
+        if (image.is_float) {
+          rgb[c] = decode_float(sample, image.is_big_endian);
+        }
+        else {
+          // Undo the gamma 2 encoding of Image::saveto
+          const float encoded = *sample * image.scale;
+          rgb[c] = encoded * encoded;
+        }
+      }
+      if (image.channels == 1) {
+        rgb[1] = rgb[2] = rgb[0];
+      }
+      loaded.texels[j * loaded.width + i] = Color{rgb[0], rgb[1], rgb[2]};
+    }
+  }
+  return loaded;
+}
+
+Texture_cache::Tile Texture_cache::filter_tile(const Image_file& image,
+                                               const Tile_key& key)
+{
+  const auto [width, height] = image.level_sizes[key.level];
+  const size_t fine_width = image.level_sizes[key.level - 1][0];
+  const size_t fine_height = image.level_sizes[key.level - 1][1];
+  const size_t x0 = key.x * tile_size, y0 = key.y * tile_size;
+  assert(x0 < width && y0 < height);
+
+  Tile filtered;
+  filtered.width = std::min(tile_size, width - x0);
+  filtered.height = std::min(tile_size, height - y0);
+  filtered.texels.resize(filtered.width * filtered.height);
+
+  // The tile covers at most 2x2 tiles of the finer level. Hold on to them so
+  // they cannot be evicted while they are read.
+  Tile_ptr fine_tiles[2][2];
+  const auto fine_texel = [&](size_t x, size_t y) {
+    x = std::min(x, fine_width - 1);
+    y = std::min(y, fine_height - 1);
+    const size_t tx = x / tile_size, ty = y / tile_size;
+    auto& fine = fine_tiles[ty - 2 * key.y][tx - 2 * key.x];
+    if (!fine) {
+      fine = tile(Tile_key{key.texture, key.level - 1,
+                           static_cast<std::uint32_t>(tx),
+                           static_cast<std::uint32_t>(ty)});
+    }
+    return fine->texels[(y % tile_size) * fine->width + x % tile_size];
+  };
+
+  for (size_t j = 0; j < filtered.height; ++j) {
+    for (size_t i = 0; i < filtered.width; ++i) {
+      const size_t x = 2 * (x0 + i), y = 2 * (y0 + j);
+      filtered.texels[j * filtered.width + i] =
+          (fine_texel(x, y) + fine_texel(x + 1, y) + fine_texel(x, y + 1) +
+           fine_texel(x + 1, y + 1)) /
+          4;
+    }
+  }
+  return filtered;
+}
@@ -0,0 +1,52 @@
+#include "thread_pool.hpp"
+
+Thread_pool::Thread_pool(size_t thread_count)
+{
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  workers_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    workers_.emplace_back([this] { work(); });
+  }
+}
+
+Thread_pool::~Thread_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopping_ = true;
+  }
+  condition_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void Thread_pool::enqueue(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    tasks_.push(std::move(task));
+  }
+  condition_.notify_one();
+}
+
+void Thread_pool::work()
+{
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      condition_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return; // stopping and nothing left to do
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
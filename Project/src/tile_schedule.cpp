@@ -0,0 +1,150 @@
+#include "tile_schedule.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+namespace {
+// Returns the cell at distance d along the Hilbert curve that fills an n x n
+// grid, n being a power of two
+std::pair<size_t, size_t> hilbert_cell(size_t n, size_t d)
+{
+  size_t x = 0, y = 0;
+  for (size_t s = 1; s < n; s *= 2) {
+    const size_t rx = 1 & (d / 2);
+    const size_t ry = 1 & (d ^ rx);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      std::swap(x, y);
+    }
+    x += s * rx;
+    y += s * ry;
+    d /= 4;
+  }
+  return {x, y};
+}
+} // anonymous namespace
+
+std::vector<Tile_rect> ordered_tiles(size_t width, size_t height,
+                                     size_t tile_size, Tile_order order)
+{
+  assert(tile_size > 0);
+  const size_t tiles_x = (width + tile_size - 1) / tile_size;
+  const size_t tiles_y = (height + tile_size - 1) / tile_size;
+  const auto tile = [&](size_t i, size_t j) {
+    const size_t x = i * tile_size, y = j * tile_size;
+    return Tile_rect{x, y, std::min(tile_size, width - x),
+                     std::min(tile_size, height - y)};
+  };
+
+  std::vector<Tile_rect> tiles;
+  tiles.reserve(tiles_x * tiles_y);
+  switch (order) {
+  case Tile_order::row_major:
+    for (size_t j = 0; j < tiles_y; ++j) {
+      for (size_t i = 0; i < tiles_x; ++i) {
+        tiles.push_back(tile(i, j));
+      }
+    }
+    break;
+
+  case Tile_order::hilbert: {
+    // The curve covers the smallest square power of two grid, the cells
+    // outside of the frame are skipped
+    size_t n = 1;
+    while (n < std::max(tiles_x, tiles_y)) {
+      n *= 2;
+    }
+    for (size_t d = 0; d < n * n && tiles.size() < tiles_x * tiles_y; ++d) {
+      const auto [i, j] = hilbert_cell(n, d);
+      if (i < tiles_x && j < tiles_y) {
+        tiles.push_back(tile(i, j));
+      }
+    }
+    break;
+  }
+
+  case Tile_order::spiral: {
+    // Rings of tiles around the center, each one clockwise from the left
+    struct Key {
+      double ring;
+      double angle;
+    };
+    std::vector<std::pair<Key, Tile_rect>> keyed;
+    keyed.reserve(tiles_x * tiles_y);
+    for (size_t j = 0; j < tiles_y; ++j) {
+      for (size_t i = 0; i < tiles_x; ++i) {
+        const auto rect = tile(i, j);
+        const auto dx = (static_cast<double>(rect.x) +
+                         static_cast<double>(rect.width) / 2 -
+                         static_cast<double>(width) / 2) /
+                        static_cast<double>(tile_size);
+        const auto dy = (static_cast<double>(rect.y) +
+                         static_cast<double>(rect.height) / 2 -
+                         static_cast<double>(height) / 2) /
+                        static_cast<double>(tile_size);
+        keyed.push_back({Key{std::round(std::max(std::abs(dx), std::abs(dy))),
+                             std::atan2(dy, dx)},
+                         rect});
+      }
+    }
+    std::stable_sort(keyed.begin(), keyed.end(),
+                     [](const auto& lhs, const auto& rhs) {
+                       return lhs.first.ring != rhs.first.ring
+                                  ? lhs.first.ring < rhs.first.ring
+                                  : lhs.first.angle < rhs.first.angle;
+                     });
+    for (const auto& [key, rect] : keyed) {
+      tiles.push_back(rect);
+    }
+    break;
+  }
+  }
+  return tiles;
+}
+
+Tile_queue::Tile_queue(const std::vector<Tile_rect>& tiles,
+                       size_t worker_count, size_t min_tile_size)
+    : tiles_(tiles.begin(), tiles.end()), worker_count_{worker_count},
+      min_tile_size_{std::max<size_t>(min_tile_size, 1)}
+{
+}
+
+std::optional<Tile_rect> Tile_queue::pop()
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (tiles_.empty()) {
+    return std::nullopt;
+  }
+  auto tile = tiles_.front();
+  tiles_.pop_front();
+
+  // Counting the taken tile, fewer tiles than workers remain
+  if (tiles_.size() + 1 < worker_count_ &&
+      (tile.width > min_tile_size_ || tile.height > min_tile_size_)) {
+    const size_t left = tile.width > min_tile_size_ ? tile.width / 2
+                                                     : tile.width;
+    const size_t top = tile.height > min_tile_size_ ? tile.height / 2
+                                                     : tile.height;
+    const auto part = [&](size_t x, size_t y, size_t width, size_t height) {
+      return Tile_rect{x, y, width, height, tile.frame};
+    };
+    // Pushed in reverse, so the quarters stay in reading order
+    if (left < tile.width && top < tile.height) {
+      tiles_.push_front(part(tile.x + left, tile.y + top, tile.width - left,
+                             tile.height - top));
+    }
+    if (top < tile.height) {
+      tiles_.push_front(part(tile.x, tile.y + top, left, tile.height - top));
+    }
+    if (left < tile.width) {
+      tiles_.push_front(part(tile.x + left, tile.y, tile.width - left, top));
+    }
+    tile = part(tile.x, tile.y, left, top);
+  }
+  return tile;
+}
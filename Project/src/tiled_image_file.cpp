@@ -0,0 +1,150 @@
+#include "tiled_image_file.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+constexpr char magic[4] = {'P', 'T', 'T', 'I'};
+constexpr std::uint32_t version = 1;
+
+void write_u32(std::ostream& os, std::uint32_t value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+std::uint32_t read_u32(std::istream& is)
+{
+  std::uint32_t value = 0;
+  is.read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+} // anonymous namespace
+
+Tiled_image_writer::Tiled_image_writer(const std::string& filename,
+                                       size_t width, size_t height,
+                                       size_t tile_size)
+    : filename_{filename}, width_{width}, height_{height},
+      tile_size_{tile_size}, file_{filename, std::ios::binary}
+{
+  if (!file_) {
+    throw Cannot_write_file{filename.c_str()};
+  }
+
+  file_.write(magic, sizeof(magic));
+  write_u32(file_, version);
+  write_u32(file_, static_cast<std::uint32_t>(width_));
+  write_u32(file_, static_cast<std::uint32_t>(height_));
+  write_u32(file_, static_cast<std::uint32_t>(tile_size_));
+}
+
+Tiled_image_writer::~Tiled_image_writer()
+{
+  try {
+    close();
+  }
+  catch (...) {
+    // Destructors must not throw, callers that care call close() themselves
+  }
+}
+
+void Tiled_image_writer::close()
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (!file_.is_open()) {
+    return;
+  }
+  // Buffered tiles may only fail to reach the file now
+  file_.flush();
+  const bool written = static_cast<bool>(file_);
+  file_.close();
+  if (!written || !file_) {
+    throw Cannot_write_file{filename_.c_str()};
+  }
+}
+
+void Tiled_image_writer::write(const Tile& tile)
+{
+  assert(tile.startX() + tile.width() <= width_);
+  assert(tile.startY() + tile.height() <= height_);
+  assert(tile.width() <= tile_size_ && tile.height() <= tile_size_);
+
+  // Convert outside of the lock so only the file access is serialized
+  std::vector<float> pixels;
+  pixels.reserve(tile.width() * tile.height() * 3);
+  for (size_t j = 0; j < tile.height(); ++j) {
+    for (size_t i = 0; i < tile.width(); ++i) {
+      const auto c = tile.at(i, j);
+      pixels.push_back(c.r);
+      pixels.push_back(c.g);
+      pixels.push_back(c.b);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  write_u32(file_, static_cast<std::uint32_t>(tile.startX()));
+  write_u32(file_, static_cast<std::uint32_t>(tile.startY()));
+  write_u32(file_, static_cast<std::uint32_t>(tile.width()));
+  write_u32(file_, static_cast<std::uint32_t>(tile.height()));
+  file_.write(reinterpret_cast<const char*>(pixels.data()),
+              static_cast<std::streamsize>(pixels.size() * sizeof(float)));
+  if (!file_) {
+    throw Cannot_write_file{filename_.c_str()};
+  }
+}
+
+Image read_tiled_image(const std::string& filename)
+{
+  std::ifstream file{filename, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error{"Cannot open tiled image " + filename};
+  }
+
+  char file_magic[4] = {};
+  file.read(file_magic, sizeof(file_magic));
+  if (!file || std::memcmp(file_magic, magic, sizeof(magic)) != 0 ||
+      read_u32(file) != version) {
+    throw std::runtime_error{filename + " is not a tiled image file"};
+  }
+
+  const size_t width = read_u32(file);
+  const size_t height = read_u32(file);
+  const size_t tile_size = read_u32(file);
+  if (!file) {
+    throw std::runtime_error{"Truncated tiled image " + filename};
+  }
+
+  Image image(width, height);
+  std::vector<float> pixels;
+  while (true) {
+    const size_t x = read_u32(file);
+    if (file.eof()) {
+      break;
+    }
+    const size_t y = read_u32(file);
+    const size_t w = read_u32(file);
+    const size_t h = read_u32(file);
+    if (!file || w > tile_size || h > tile_size || x + w > width ||
+        y + h > height) {
+      throw std::runtime_error{"Corrupted tile in " + filename};
+    }
+
+    pixels.resize(w * h * 3);
+    file.read(reinterpret_cast<char*>(pixels.data()),
+              static_cast<std::streamsize>(pixels.size() * sizeof(float)));
+    if (!file) {
+      throw std::runtime_error{"Truncated tiled image " + filename};
+    }
+
+    for (size_t j = 0; j < h; ++j) {
+      Color* row = image.row(y + j) + x;
+      for (size_t i = 0; i < w; ++i) {
+        const float* p = &pixels[(j * w + i) * 3];
+        row[i] = Color{p[0], p[1], p[2]};
+      }
+    }
+  }
+
+  return image;
+}
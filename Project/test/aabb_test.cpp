@@ -45,3 +45,9 @@ TEST_CASE("Compose AABBs", "[AABB]")
   AABB box1{{-1, -1, -1}, {0.5, 0.5, 0.5}};
   REQUIRE(surrounding_box(box0, box1) == AABB{{-1, -1, -1}, {1, 1, 1}});
 }
+
+TEST_CASE("AABB surface area", "[AABB]")
+{
+  REQUIRE(AABB({0, 0, 0}, {1, 2, 3}).surface_area() == Approx(22));
+  REQUIRE(AABB({1, 1, 1}, {0, 0, 0}).surface_area() == 0);
+}
@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "arena.hpp"
+
+namespace {
+bool is_aligned(const void* p, size_t alignment)
+{
+  return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+}
+} // anonymous namespace
+
+TEST_CASE("Arena", "[Memory]")
+{
+  Arena arena{1024};
+
+  SECTION("Objects are constructed in place and suitably aligned")
+  {
+    const auto c = arena.create<char>('a');
+    const auto d = arena.create<double>(2.5);
+    REQUIRE(*c == 'a');
+    REQUIRE(*d == 2.5);
+    REQUIRE(is_aligned(d, alignof(double)));
+  }
+
+  SECTION("Consecutive objects are contiguous")
+  {
+    const auto first = arena.create<int>(1);
+    const auto second = arena.create<int>(2);
+    REQUIRE(second == first + 1);
+    REQUIRE(arena.bytes_used() == 2 * sizeof(int));
+  }
+
+  SECTION("Blocks are added as needed")
+  {
+    std::vector<int*> values;
+    for (int i = 0; i < 1000; ++i) {
+      values.push_back(arena.create<int>(i));
+    }
+    for (int i = 0; i < 1000; ++i) {
+      REQUIRE(*values[i] == i);
+    }
+    REQUIRE(arena.bytes_reserved() >= 1000 * sizeof(int));
+    REQUIRE(arena.bytes_reserved() < 2000 * sizeof(int));
+  }
+
+  SECTION("Large objects do not waste the current block")
+  {
+    const auto small = arena.create<int>(1);
+    arena.allocate(4096, 16);
+    const auto next = arena.create<int>(2);
+    REQUIRE(next == small + 1);
+    REQUIRE(arena.bytes_reserved() == 1024 + 4096);
+  }
+
+  SECTION("Objects keep their address when the arena is moved")
+  {
+    const auto value = arena.create<int>(7);
+    const Arena moved{std::move(arena)};
+    REQUIRE(*value == 7);
+    REQUIRE(moved.bytes_used() == sizeof(int));
+  }
+
+  SECTION("A moved-from arena starts over")
+  {
+    const auto value = arena.create<int>(7);
+    Arena moved{std::move(arena)};
+    REQUIRE(arena.bytes_used() == 0);
+    REQUIRE(arena.bytes_reserved() == 0);
+
+    const auto other = arena.create<int>(8);
+    REQUIRE(*other == 8);
+    REQUIRE(*value == 7);
+    REQUIRE(arena.bytes_used() == sizeof(int));
+
+    arena = std::move(moved);
+    REQUIRE(*value == 7);
+    REQUIRE(arena.bytes_used() == sizeof(int));
+    REQUIRE(moved.bytes_reserved() == 0);
+    REQUIRE(*moved.create<int>(9) == 9);
+  }
+}
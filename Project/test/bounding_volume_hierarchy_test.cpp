@@ -0,0 +1,140 @@
+#include <catch2/catch.hpp>
+#include <limits>
+#include <vector>
+
+#include "arena.hpp"
+#include "bounding_volume_hierarchy.hpp"
+#include "ray.hpp"
+#include "sphere.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+const Lambertian dummy_mat{Color(0.5f, 0.5f, 0.5f)};
+constexpr float inf = std::numeric_limits<float>::infinity();
+
+// A row of unit spheres along x, with pointers to move them later
+struct Sphere_row {
+  Arena arena;
+  std::vector<Sphere*> spheres;
+  BVH_node* bvh = nullptr;
+
+  explicit Sphere_row(int count)
+  {
+    std::vector<Hitable*> objects;
+    for (int i = 0; i < count; ++i) {
+      spheres.push_back(arena.create<Sphere>(
+          Point3f{3.f * static_cast<float>(i), 0, 0}, 1, dummy_mat));
+      objects.push_back(spheres.back());
+    }
+    bvh = arena.create<BVH_node>(arena, objects.begin(), objects.end());
+  }
+};
+} // anonymous namespace
+
+TEST_CASE("BVH refitting", "[geometry]")
+{
+  Thread_pool pool{4};
+  Sphere_row row{64};
+  const float build_cost = row.bvh->build_sah_cost();
+  REQUIRE(build_cost > 0);
+
+  SECTION("Refitting an unchanged tree keeps its cost")
+  {
+    row.bvh->refit(pool);
+    REQUIRE(row.bvh->sah_cost() == Approx(build_cost));
+  }
+
+  SECTION("Refitted bounds follow moved primitives")
+  {
+    for (auto sphere : row.spheres) {
+      sphere->center.y += 10;
+    }
+    row.bvh->refit(pool);
+    REQUIRE(*row.bvh->bounding_box() == AABB({-1, 9, -1}, {190, 11, 1}));
+
+    const Ray ray{{30, 10, -5}, {0, 0, 1}};
+    const auto intersection = row.bvh->intersect_at(ray, 0, inf);
+    REQUIRE(intersection);
+    REQUIRE(intersection->object == row.spheres[10]);
+  }
+
+  SECTION("Uneven trees are refitted")
+  {
+    // The first child of the root holds primitives only, its sibling does not
+    Sphere_row uneven{5};
+    for (auto sphere : uneven.spheres) {
+      sphere->center.z += 4;
+    }
+    uneven.bvh->refit(pool);
+    REQUIRE(*uneven.bvh->bounding_box() == AABB({-1, -1, 3}, {13, 1, 5}));
+
+    const Ray ray{{12, 0, -5}, {0, 0, 1}};
+    const auto intersection = uneven.bvh->intersect_at(ray, 0, inf);
+    REQUIRE(intersection);
+    REQUIRE(intersection->object == uneven.spheres[4]);
+  }
+
+  SECTION("Small motion is refitted")
+  {
+    row.spheres[5]->center.z += 0.5f;
+    REQUIRE_FALSE(refit_or_rebuild(row.bvh, row.arena, pool));
+  }
+
+  SECTION("Shuffling the primitives triggers a rebuild")
+  {
+    // Sphere i moves to where sphere 37 * i mod 64 was
+    for (size_t i = 0; i < row.spheres.size(); ++i) {
+      row.spheres[i]->center.x = 3.f * static_cast<float>(37 * i % 64);
+    }
+    REQUIRE(refit_or_rebuild(row.bvh, row.arena, pool));
+    REQUIRE(row.bvh->sah_cost() == Approx(build_cost));
+
+    // 37 * 26 mod 64 = 2
+    const Ray ray{{6, 0, -5}, {0, 0, 1}};
+    const auto intersection = row.bvh->intersect_at(ray, 0, inf);
+    REQUIRE(intersection);
+    REQUIRE(intersection->object == row.spheres[26]);
+  }
+}
+
+TEST_CASE("BVH over moving primitives", "[geometry]")
+{
+  Arena arena;
+  std::vector<Hitable*> objects;
+  objects.push_back(arena.create<Sphere>(Point3f{0, 0, 0}, Point3f{10, 0, 0},
+                                         1, dummy_mat));
+  objects.push_back(arena.create<Sphere>(Point3f{0, 5, 0}, 1, dummy_mat));
+  objects.push_back(arena.create<Sphere>(Point3f{0, -5, 0}, 1, dummy_mat));
+  const BVH_node bvh{arena, objects.begin(), objects.end()};
+
+  REQUIRE(*bvh.bounding_box() == AABB({-1, -6, -1}, {11, 6, 1}));
+  REQUIRE(*bvh.bounding_box_at(0) == AABB({-1, -6, -1}, {1, 6, 1}));
+  REQUIRE(*bvh.bounding_box_at(1) == AABB({-1, -6, -1}, {11, 6, 1}));
+
+  const Ray at_start({10, 0, -5}, {0, 0, 1}, 0);
+  REQUIRE_FALSE(bvh.intersect_at(at_start, 0, inf));
+
+  const Ray at_end({10, 0, -5}, {0, 0, 1}, 1);
+  const auto intersection = bvh.intersect_at(at_end, 0, inf);
+  REQUIRE(intersection);
+  REQUIRE(intersection->t == Approx(4));
+}
+
+TEST_CASE("BVH over an odd number of primitives", "[geometry]")
+{
+  Arena arena;
+  std::vector<Hitable*> objects;
+  for (int i = 0; i < 5; ++i) {
+    objects.push_back(arena.create<Sphere>(
+        Point3f{3.f * static_cast<float>(i), 0, 0}, 1, dummy_mat));
+  }
+  const BVH_node bvh{arena, objects.begin(), objects.end()};
+
+  REQUIRE(bvh.primitives().size() == 5);
+  REQUIRE(*bvh.bounding_box() == AABB({-1, -1, -1}, {13, 1, 1}));
+
+  const Ray ray{{12, 0, -5}, {0, 0, 1}};
+  const auto intersection = bvh.intersect_at(ray, 0, inf);
+  REQUIRE(intersection);
+  REQUIRE(intersection->object == objects[4]);
+}
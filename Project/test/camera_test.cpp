@@ -1,8 +1,91 @@
 #include <catch2/catch.hpp>
 
 #include "camera.hpp"
+#include "sampler.hpp"
 
 TEST_CASE("Camera", "[Scene]")
 {
-  // TODO(lesley):
+  const Camera camera{
+      {0, 0, 0}, {0, 0, -1}, {0, 1, 0}, 90.0_deg, 1, 0.25f, 0.75f};
+
+  SECTION("The film center looks at the target")
+  {
+    const auto ray = camera.get_ray(Camera_sample{{0.5f, 0.5f}});
+    const auto direction = normalize(ray.direction);
+    REQUIRE(direction.x == Approx(0).margin(1e-6));
+    REQUIRE(direction.y == Approx(0).margin(1e-6));
+    REQUIRE(direction.z == Approx(-1));
+  }
+
+  SECTION("Time samples are mapped to the shutter interval")
+  {
+    REQUIRE(camera.get_ray(Camera_sample{{0.5f, 0.5f}, 0}).time ==
+            Approx(0.25f));
+    REQUIRE(camera.get_ray(Camera_sample{{0.5f, 0.5f}, 0.5f}).time ==
+            Approx(0.5f));
+  }
+}
+
+TEST_CASE("Thin lens camera", "[Scene]")
+{
+  const Camera camera{
+      {0, 0, 0}, {0, 0, -1}, {0, 1, 0}, 90.0_deg, 1, 0, 0, 0.5f, 4};
+
+  SECTION("Rays through a film position meet on the plane in focus")
+  {
+    const Point2f film_pos{0.3f, 0.8f};
+    const auto pinhole =
+        camera.get_ray(Camera_sample{film_pos, 0, {0.5f, 0.5f}});
+    REQUIRE(pinhole.origin == Point3f{0, 0, 0});
+
+    const auto focus = pinhole.point_at_parameter(1);
+    REQUIRE(focus.z == Approx(-4));
+    for (const Point2f lens : {Point2f{0, 0}, Point2f{0.9f, 0.2f},
+                               Point2f{0.4f, 0.99f}}) {
+      const auto ray = camera.get_ray(Camera_sample{film_pos, 0, lens});
+      REQUIRE(ray.origin.z == Approx(0));
+      REQUIRE((ray.origin - Point3f{0, 0, 0}).length() <= 0.25f + 1e-6f);
+
+      const auto p = ray.point_at_parameter(1);
+      REQUIRE(p.x == Approx(focus.x));
+      REQUIRE(p.y == Approx(focus.y));
+      REQUIRE(p.z == Approx(focus.z));
+    }
+  }
+
+  SECTION("Batched rays match the rays of single samples")
+  {
+    const Tile_region tile{3, 5, 4, 2, 16, 8};
+    Camera_ray_batch rays;
+    camera.generate_rays(42, tile, 7, rays);
+    REQUIRE(rays.size() == tile.pixel_count());
+
+    size_t i = 0;
+    for (size_t y = tile.y; y < tile.y + tile.height; ++y) {
+      for (size_t x = tile.x; x < tile.x + tile.width; ++x, ++i) {
+        Sampler sampler{42, y * tile.image_width + x, 7};
+        const auto offset = sampler.next_2d();
+        const float time = sampler.next_1d();
+        const auto lens_pos = sampler.next_2d();
+        REQUIRE(sampler.dimension() == Camera::sample_dimensions);
+
+        const auto expected = camera.get_ray(
+            Camera_sample{{(x + offset.x) / 16, (y + offset.y) / 8},
+                          time,
+                          lens_pos});
+        const auto ray = rays.ray(i);
+        REQUIRE(ray.origin.x == Approx(expected.origin.x).margin(1e-6));
+        REQUIRE(ray.origin.y == Approx(expected.origin.y).margin(1e-6));
+        REQUIRE(ray.direction.x == Approx(expected.direction.x).margin(1e-5));
+        REQUIRE(ray.direction.y == Approx(expected.direction.y).margin(1e-5));
+        REQUIRE(ray.direction.z == Approx(expected.direction.z).margin(1e-5));
+        REQUIRE(ray.time == expected.time);
+
+        // The path continues where the camera stopped drawing
+        auto continued = rays.samplers[i];
+        REQUIRE(continued.dimension() == Camera::sample_dimensions);
+        REQUIRE(continued.next_1d() == sampler.next_1d());
+      }
+    }
+  }
 }
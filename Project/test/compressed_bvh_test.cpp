@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+#include <limits>
+#include <vector>
+
+#include "arena.hpp"
+#include "bounding_volume_hierarchy.hpp"
+#include "compressed_bvh.hpp"
+#include "random.hpp"
+#include "ray.hpp"
+#include "sphere.hpp"
+
+namespace {
+const Lambertian dummy_mat{Color(0.5f, 0.5f, 0.5f)};
+constexpr float inf = std::numeric_limits<float>::infinity();
+} // anonymous namespace
+
+TEST_CASE("Compressed BVH", "[geometry]")
+{
+  Arena arena;
+  Pcg32 rng;
+  std::vector<Hitable*> objects;
+  for (int i = 0; i < 500; ++i) {
+    const Point3f center{100 * rng.next_float(), 100 * rng.next_float(),
+                         100 * rng.next_float()};
+    const float radius = 0.1f + 2 * rng.next_float();
+    objects.push_back(arena.create<Sphere>(center, radius, dummy_mat));
+  }
+  objects.push_back(arena.create<Sphere>(Point3f{50, 50, 50},
+                                         Point3f{60, 50, 50}, 1, dummy_mat));
+  const auto bvh =
+      arena.create<BVH_node>(arena, objects.begin(), objects.end());
+  const Compressed_BVH compressed{arena, *bvh};
+
+  SECTION("Has the bounds of the uncompressed tree")
+  {
+    REQUIRE(*compressed.bounding_box() == *bvh->bounding_box());
+  }
+
+  SECTION("Finds the same closest hits as the uncompressed tree")
+  {
+    int hit_count = 0;
+    for (int i = 0; i < 2000; ++i) {
+      const Point3f origin{100 * rng.next_float(), 100 * rng.next_float(),
+                           -10};
+      const Vec3f direction{rng.next_float() - 0.5f, rng.next_float() - 0.5f,
+                            1};
+      const Ray ray{origin, direction, rng.next_float()};
+
+      const auto expected = bvh->intersect_at(ray, 0.001f, inf);
+      const auto actual = compressed.intersect_at(ray, 0.001f, inf);
+      REQUIRE(actual.has_value() == expected.has_value());
+      if (expected) {
+        ++hit_count;
+        REQUIRE(actual->object == expected->object);
+        REQUIRE(actual->t == expected->t);
+      }
+    }
+    REQUIRE(hit_count > 100);
+  }
+
+  SECTION("Axis aligned rays through a face of a box")
+  {
+    Arena flat_arena;
+    std::vector<Hitable*> flat{
+        flat_arena.create<Sphere>(Point3f{0, 0, 0}, 1, dummy_mat),
+        flat_arena.create<Sphere>(Point3f{4, 0, 0}, 1, dummy_mat)};
+    const auto flat_bvh =
+        flat_arena.create<BVH_node>(flat_arena, flat.begin(), flat.end());
+    const Compressed_BVH flat_compressed{flat_arena, *flat_bvh};
+
+    const Ray ray{{4, 1, -5}, {0, 0, 1}};
+    const auto intersection = flat_compressed.intersect_at(ray, 0, inf);
+    REQUIRE(intersection);
+    REQUIRE(intersection->object == flat[1]);
+  }
+
+  SECTION("Takes less memory than the uncompressed tree")
+  {
+    REQUIRE(compressed.node_count() < objects.size() / 2);
+    REQUIRE(compressed.node_count() > objects.size() / 4);
+    REQUIRE(compressed.memory_size() <
+            (objects.size() - 1) * sizeof(BVH_node));
+  }
+}
@@ -0,0 +1,127 @@
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+#include "bounding_volume_hierarchy.hpp"
+#include "camera.hpp"
+#include "distributed.hpp"
+#include "image.hpp"
+#include "local_socket.hpp"
+#include "material.hpp"
+#include "pathtracer.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+
+namespace {
+const Lambertian diffuse{Color(0.5f, 0.5f, 0.5f)};
+const Emission light{Color(4, 4, 4)};
+constexpr auto socket_path = "distributed_test.sock";
+
+Scene test_scene()
+{
+  Arena arena;
+  std::vector<Hitable*> objects;
+  objects.push_back(arena.create<Sphere>(Point3f{0, 0, -3}, 1, diffuse));
+  objects.push_back(arena.create<Sphere>(Point3f{0, 3, -3}, 1, light));
+  const auto bvh =
+      arena.create<BVH_node>(arena, objects.begin(), objects.end());
+  return Scene(std::move(arena), *bvh);
+}
+
+bool same_image(const Image& lhs, const Image& rhs)
+{
+  for (size_t y = 0; y < lhs.height(); ++y) {
+    for (size_t x = 0; x < lhs.width(); ++x) {
+      if (!(lhs.color_at(x, y) == rhs.color_at(x, y))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Takes a job and drops the connection without answering, after waiting for
+// the coordinator to give up on it if hang is set. Returns whether it got a
+// job.
+bool run_failing_worker(std::promise<void>& has_job, bool hang)
+{
+  Local_socket socket;
+  while (!socket.is_open()) {
+    try {
+      socket = Local_socket::connect(socket_path);
+    }
+    catch (const std::runtime_error&) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+  }
+
+  // The session followed by the first job
+  char message[2 * sizeof(std::uint32_t) + 6 * sizeof(std::uint64_t)];
+  const bool received = socket.receive_all(message, sizeof(message));
+  has_job.set_value();
+  if (hang) {
+    // Returns once the coordinator drops the connection
+    socket.receive_all(message, 1);
+  }
+  return received;
+}
+} // anonymous namespace
+
+TEST_CASE("Distributed rendering", "[Integrator]")
+{
+  const auto scene = test_scene();
+  const Camera camera{{0, 0, 0}, {0, 0, -1}, {0, 1, 0}, 60.0_deg, 1.25f};
+
+  Render_settings render;
+  render.seed = 7;
+  render.thread_count = 2;
+  Image expected(80, 64);
+  Path_tracer{render}.run(scene, camera, expected, 3);
+
+  // Tiles of another size than the ones of the reference image
+  Coordinator_settings settings;
+  settings.socket_path = socket_path;
+  settings.render = render;
+  settings.render.thread_count = 0;
+  settings.render.tile_size = 16;
+  settings.tiles_per_job = 1;
+  settings.worker_timeout = std::chrono::milliseconds{500};
+  Image image(80, 64);
+
+  SECTION("Workers render the same image as a Path_tracer")
+  {
+    std::thread first{[&] { run_worker(socket_path, scene, camera, 2); }};
+    std::thread second{[&] { run_worker(socket_path, scene, camera, 1); }};
+    run_coordinator(settings, image, 3);
+    first.join();
+    second.join();
+    REQUIRE(same_image(image, expected));
+  }
+
+  SECTION("Jobs of workers that fail are reissued")
+  {
+    for (const bool hang : {false, true}) {
+      std::promise<void> has_job;
+      auto failed = std::async(std::launch::async, [&] {
+        return run_failing_worker(has_job, hang);
+      });
+      std::thread worker{[&] {
+        has_job.get_future().wait();
+        run_worker(socket_path, scene, camera, 2);
+      }};
+      run_coordinator(settings, image, 3);
+      worker.join();
+      REQUIRE(failed.get());
+      REQUIRE(same_image(image, expected));
+    }
+  }
+
+  SECTION("The coordinator gives up without workers")
+  {
+    settings.worker_timeout = std::chrono::milliseconds{100};
+    REQUIRE_THROWS_AS(run_coordinator(settings, image, 3),
+                      std::runtime_error);
+  }
+}
@@ -0,0 +1,111 @@
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+#include "film.hpp"
+#include "image.hpp"
+
+TEST_CASE("Film", "[Graphics]")
+{
+  Film film(4, 3, 42);
+  film.add_samples(1, 2, Color{2, 4, 6}, 2);
+  film.add_samples(1, 2, Color{1, 0, 0}, 1);
+
+  SECTION("Accumulates sums and sample counts per pixel")
+  {
+    REQUIRE(film.sum_at(1, 2).value() == Color(3, 4, 6));
+    REQUIRE(film.sample_count_at(1, 2) == 3);
+    REQUIRE(film.sample_count_at(0, 0) == 0);
+    REQUIRE(film.min_sample_count() == 0);
+  }
+
+  SECTION("Develops the average of the samples into an image")
+  {
+    Image image(4, 3);
+    film.develop(image);
+    REQUIRE(image.color_at(1, 2).r == Approx(1));
+    REQUIRE(image.color_at(1, 2).g == Approx(4.f / 3));
+    REQUIRE(image.color_at(0, 0) == Color(0, 0, 0));
+  }
+
+  SECTION("Save and load round trip")
+  {
+    const std::string filename = "film_test.ptfm";
+    film.save(filename);
+    const auto loaded = Film::load(filename);
+    std::remove(filename.c_str());
+
+    REQUIRE(loaded.width() == 4);
+    REQUIRE(loaded.height() == 3);
+    REQUIRE(loaded.seed() == 42);
+    REQUIRE(loaded.first_sample() == 0);
+    REQUIRE(loaded.sum_at(1, 2).value() == Color(3, 4, 6));
+    REQUIRE(loaded.sample_count_at(1, 2) == 3);
+  }
+
+  SECTION("Merges the samples that continue its own")
+  {
+    Film next(4, 3, 42, 3);
+    next.add_samples(1, 2, Color{1, 1, 1}, 2);
+    film.merge(next);
+    REQUIRE(film.sum_at(1, 2).value() == Color(4, 5, 7));
+    REQUIRE(film.sample_count_at(1, 2) == 5);
+
+    Film gap(4, 3, 42, 6);
+    gap.add_samples(1, 2, Color{1, 1, 1}, 1);
+    REQUIRE_THROWS_AS(film.merge(gap), std::invalid_argument);
+    REQUIRE_THROWS_AS(film.merge(Film(4, 3, 7, 5)), std::invalid_argument);
+  }
+
+  SECTION("Loading a missing file throws")
+  {
+    REQUIRE_THROWS_AS(Film::load("no_such_film.ptfm"), std::runtime_error);
+  }
+
+  SECTION("Loading a file whose size does not match its header throws")
+  {
+    const std::string filename = "film_test.ptfm";
+    film.save(filename);
+    {
+      // Width and height follow the magic and the version
+      std::fstream file{filename,
+                        std::ios::binary | std::ios::in | std::ios::out};
+      file.seekp(8);
+      const std::uint32_t huge[] = {0xffffffff, 0xffffffff};
+      file.write(reinterpret_cast<const char*>(huge), sizeof(huge));
+    }
+    REQUIRE_THROWS_AS(Film::load(filename), std::runtime_error);
+
+    film.save(filename);
+    {
+      std::ofstream file{filename, std::ios::binary | std::ios::app};
+      file << "extra";
+    }
+    REQUIRE_THROWS_AS(Film::load(filename), std::runtime_error);
+    std::remove(filename.c_str());
+  }
+}
+
+TEST_CASE("Radiance sums do not depend on grouping", "[Graphics]")
+{
+  const Color samples[] = {Color(0.1f, 3e-5f, 7), Color(1e-3f, 0.3f, 2),
+                           Color(0.7f, 11, 0), Color(5e3f, 0.2f, 0.9f)};
+
+  Radiance_sum sequential;
+  for (const auto& sample : samples) {
+    sequential += sample;
+  }
+
+  Radiance_sum first, second;
+  first += samples[0];
+  first += samples[1];
+  second += samples[2];
+  second += samples[3];
+  second += first;
+  REQUIRE(second == sequential);
+
+  Radiance_sum invalid;
+  invalid += Color(std::nanf(""), -1, 0);
+  REQUIRE(invalid.value() == Color(0, 0, 0));
+}
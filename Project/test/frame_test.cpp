@@ -0,0 +1,26 @@
+#include <catch2/catch.hpp>
+
+#include "frame.hpp"
+
+TEST_CASE("Orthonormal frames", "[math]")
+{
+  const auto n = GENERATE(Vec3f{0, 0, 1}, Vec3f{0, 0, -1}, Vec3f{1, 0, 0},
+                          normalize(Vec3f{1, -2, 3}));
+  const auto frame = Frame::from_normal(n);
+
+  SECTION("Axes are unit length and perpendicular")
+  {
+    REQUIRE(frame.s.length() == Approx(1));
+    REQUIRE(frame.t.length() == Approx(1));
+    REQUIRE(dot(frame.s, frame.t) == Approx(0).margin(1e-6));
+    REQUIRE(dot(frame.s, frame.n) == Approx(0).margin(1e-6));
+    REQUIRE(dot(frame.t, frame.n) == Approx(0).margin(1e-6));
+  }
+
+  SECTION("Local +z is the normal and conversions are inverse")
+  {
+    REQUIRE((frame.to_world(Vec3f{0, 0, 1}) - n).length() < 1e-6f);
+    const Vec3f v{0.3f, -0.2f, 0.9f};
+    REQUIRE((frame.to_local(frame.to_world(v)) - v).length() < 1e-6f);
+  }
+}
@@ -1,6 +1,11 @@
 #include <catch2/catch.hpp>
 
+#include <cmath>
+#include <limits>
+
 #include "image.hpp"
+#include "thread_pool.hpp"
+#include "tile.hpp"
 
 TEST_CASE("Image", "[Graphics]")
 {
@@ -23,4 +28,78 @@ TEST_CASE("Image", "[Graphics]")
     REQUIRE_THROWS_AS(img.color_at(200, 0), std::out_of_range);
     REQUIRE_THROWS_AS(img.color_at(0, 100), std::out_of_range);
   }
+
+  SECTION("Rows are the pixels color_at accesses")
+  {
+    img.row(50)[100] = Color(0, 1, 0);
+    REQUIRE(img.color_at(100, 50).g == 1);
+    REQUIRE(img.row(49) + img.width() == img.row(50));
+  }
+
+  SECTION("Blit copies a tile to its place")
+  {
+    Tile tile{190, 98, 10, 2};
+    tile.at(9, 1) = Color(1, 2, 3);
+    img.blit(tile);
+    REQUIRE(img.color_at(199, 99).b == 3);
+    REQUIRE(img.color_at(189, 99).b == 0);
+  }
+
+  SECTION("Operations on every pixel")
+  {
+    img.color_at(3, 4) = Color(4, 1, -1);
+    img.scale(0.5f);
+    REQUIRE(img.color_at(3, 4).r == 2);
+
+    Image other(200, 100);
+    other.color_at(3, 4) = Color(2, 0, 0);
+    img += other;
+    REQUIRE(img.color_at(3, 4).r == 4);
+    REQUIRE_THROWS_AS(img += Image(1, 1), std::invalid_argument);
+
+    img.apply_gamma(2);
+    REQUIRE(img.color_at(3, 4).r == Approx(2));
+    REQUIRE(img.color_at(3, 4).b == 0);
+
+    img.tonemap();
+    REQUIRE(img.color_at(3, 4).r == Approx(2.f / 3));
+  }
+}
+
+TEST_CASE("Conversion of an image to 8 bits", "[Graphics]")
+{
+  // An odd width leaves components after the vectorized ones
+  Image image(37, 21);
+  for (size_t y = 0; y < image.height(); ++y) {
+    for (size_t x = 0; x < image.width(); ++x) {
+      const auto v = static_cast<float>(x * 21 + y) / 500;
+      image.color_at(x, y) = Color(v, v * v, 1 - v);
+    }
+  }
+  image.color_at(5, 5) = Color(std::numeric_limits<float>::quiet_NaN(), 2,
+                               -1);
+
+  const auto rgb = image.to_rgb8();
+  REQUIRE(rgb.size() == 37 * 21 * 3);
+
+  // Pixels are stored in reverse, gamma 2 encoded and clamped
+  const auto expected = [](float c) {
+    c = std::isnan(c) ? 0 : std::min(1.f, std::max(0.f, c));
+    return static_cast<std::uint8_t>(255.99f * std::sqrt(c));
+  };
+  bool same = true;
+  for (size_t y = 0; y < image.height(); ++y) {
+    for (size_t x = 0; x < image.width(); ++x) {
+      const auto c = image.color_at(x, y);
+      const auto* p = &rgb[(image.width() * image.height() - 1 -
+                            (y * image.width() + x)) *
+                           3];
+      same = same && p[0] == expected(c.r) && p[1] == expected(c.g) &&
+             p[2] == expected(c.b);
+    }
+  }
+  REQUIRE(same);
+
+  Thread_pool pool{3};
+  REQUIRE(image.to_rgb8(pool) == rgb);
 }
@@ -0,0 +1,88 @@
+#include <catch2/catch.hpp>
+#include <limits>
+#include <vector>
+
+#include "arena.hpp"
+#include "bounding_volume_hierarchy.hpp"
+#include "instance.hpp"
+#include "ray.hpp"
+#include "sphere.hpp"
+
+namespace {
+const Lambertian dummy_mat{Color(0.5f, 0.5f, 0.5f)};
+constexpr float inf = std::numeric_limits<float>::infinity();
+} // anonymous namespace
+
+TEST_CASE("Instances place shared geometry", "[geometry]")
+{
+  const Sphere unit_sphere{Point3f{0, 0, 0}, 1, dummy_mat};
+  const Instance instance{unit_sphere,
+                          Transform::translate(Vec3f{0, 0, 5}) *
+                              Transform::scale(Vec3f{2, 2, 2})};
+
+  SECTION("Bounding box in world space")
+  {
+    REQUIRE(*instance.bounding_box() == AABB({-2, -2, 3}, {2, 2, 7}));
+  }
+
+  SECTION("Hit distance and surface data in world space")
+  {
+    const Ray ray{{0, 0, 0}, {0, 0, 1}};
+    const auto intersection = instance.intersect_at(ray, 0, inf);
+    REQUIRE(intersection);
+    REQUIRE(intersection->t == Approx(3));
+    REQUIRE(&intersection->surface_owner() == &instance);
+
+    const auto record = instance.surface_at(ray, *intersection);
+    REQUIRE(record.point.z == Approx(3));
+    REQUIRE(record.normal.z == Approx(-1));
+    REQUIRE(record.material == &dummy_mat);
+  }
+}
+
+TEST_CASE("Two-level hierarchy over instances", "[geometry]")
+{
+  const Sphere unit_sphere{Point3f{0, 0, 0}, 1, dummy_mat};
+
+  Arena arena;
+  std::vector<Hitable*> instances;
+  for (int i = 0; i < 100; ++i) {
+    instances.push_back(arena.create<Instance>(
+        unit_sphere,
+        Transform::translate(Vec3f{static_cast<float>(3 * (i % 10)), 0,
+                                   static_cast<float>(3 * (i / 10))})));
+  }
+  const BVH_node top_level{arena, instances.begin(), instances.end()};
+
+  // Passes through the spheres of the column x = 9, closest one at z = 0
+  const Ray ray{{9, 0, -10}, {0, 0, 1}};
+  const auto intersection = top_level.intersect_at(ray, 0, inf);
+  REQUIRE(intersection);
+  REQUIRE(intersection->t == Approx(9));
+
+  const auto record = top_level.surface_at(ray, *intersection);
+  REQUIRE(record.point.x == Approx(9));
+  REQUIRE(record.point.z == Approx(-1));
+}
+
+TEST_CASE("Moving instances", "[geometry]")
+{
+  const Sphere unit_sphere{Point3f{0, 0, 0}, 1, dummy_mat};
+  const Instance instance{unit_sphere, Transform::translate(Vec3f{0, 0, 5}),
+                          Transform::translate(Vec3f{4, 0, 5})};
+
+  REQUIRE(*instance.bounding_box() == AABB({-1, -1, 4}, {5, 1, 6}));
+  REQUIRE(*instance.bounding_box_at(0.5f) == AABB({1, -1, 4}, {3, 1, 6}));
+
+  const Ray early{{2, 0, 0}, {0, 0, 1}, 0};
+  REQUIRE_FALSE(instance.intersect_at(early, 0, inf));
+
+  const Ray middle{{2, 0, 0}, {0, 0, 1}, 0.5f};
+  const auto intersection = instance.intersect_at(middle, 0, inf);
+  REQUIRE(intersection);
+  REQUIRE(intersection->t == Approx(4));
+
+  const auto record = instance.surface_at(middle, *intersection);
+  REQUIRE(record.point.x == Approx(2));
+  REQUIRE(record.normal.z == Approx(-1));
+}
@@ -0,0 +1,155 @@
+#include <catch2/catch.hpp>
+#include <cmath>
+
+#include "material.hpp"
+#include "sampler.hpp"
+#include "sampling.hpp"
+
+namespace {
+const Hit_record up_facing{1, {0, 0, 0}, {0, 0, 1}, nullptr};
+} // anonymous namespace
+
+TEST_CASE("Lambertian BSDF", "[Material]")
+{
+  const Lambertian lambertian{Color(0.5f, 0.5f, 0.5f)};
+  const Vec3f wo = normalize(Vec3f{1, 0, 1});
+
+  SECTION("Sampled values agree with eval and pdf")
+  {
+    for (std::uint64_t i = 0; i < 100; ++i) {
+      Sampler sampler{0, i, 0};
+      const auto s = lambertian.sample(wo, up_facing, sampler);
+      REQUIRE(s);
+      REQUIRE_FALSE(s->is_specular);
+      REQUIRE(s->wi.z > 0);
+      REQUIRE(s->pdf == Approx(lambertian.pdf(wo, s->wi, up_facing)));
+      REQUIRE(s->f.r == Approx(lambertian.eval(wo, s->wi, up_facing).r));
+    }
+  }
+
+  SECTION("Directions below the surface have zero value and density")
+  {
+    const Vec3f below{0, 0, -1};
+    REQUIRE(lambertian.eval(wo, below, up_facing) == Color(0, 0, 0));
+    REQUIRE(lambertian.pdf(wo, below, up_facing) == 0);
+  }
+
+  SECTION("Reflects on the side it is seen from")
+  {
+    Sampler sampler{0, 0, 0};
+    const auto s = lambertian.sample(-wo, up_facing, sampler);
+    REQUIRE(s);
+    REQUIRE(s->wi.z < 0);
+  }
+}
+
+// Estimates the light reflected by a white diffuse surface under a sky whose
+// radiance is the cosine to the zenith. The exact answer is 2/3.
+TEST_CASE("Cosine-weighted sampling converges faster than uniform sampling",
+          "[Material]")
+{
+  const Lambertian white{Color(1, 1, 1)};
+  const Vec3f wo{0, 0, 1};
+  const auto sky = [](Vec3f w) { return std::max(0.f, w.z); };
+  constexpr double expected = 2.0 / 3;
+  constexpr int sample_per_pixel = 16;
+  constexpr int pixel_count = 2000;
+
+  double cosine_error = 0;
+  double uniform_error = 0;
+  for (int pixel = 0; pixel < pixel_count; ++pixel) {
+    double cosine_estimate = 0;
+    double uniform_estimate = 0;
+    for (int sample = 0; sample < sample_per_pixel; ++sample) {
+      Sampler sampler{1, static_cast<std::uint64_t>(pixel),
+                      static_cast<std::uint64_t>(sample)};
+
+      const auto s = white.sample(wo, up_facing, sampler);
+      REQUIRE(s);
+      cosine_estimate += s->f.r * s->wi.z / s->pdf * sky(s->wi);
+
+      // Uniform hemisphere directions weighted by the BSDF
+      auto wi = uniform_sample_sphere(sampler.next_2d());
+      wi.z = std::abs(wi.z);
+      const float pdf = 2 * uniform_sphere_pdf();
+      uniform_estimate +=
+          white.eval(wo, wi, up_facing).r * wi.z / pdf * sky(wi);
+    }
+
+    cosine_error += std::pow(cosine_estimate / sample_per_pixel - expected, 2);
+    uniform_error +=
+        std::pow(uniform_estimate / sample_per_pixel - expected, 2);
+  }
+
+  const double cosine_rmse = std::sqrt(cosine_error / pixel_count);
+  const double uniform_rmse = std::sqrt(uniform_error / pixel_count);
+  // The variances are 1/18 and 16/45, a ratio of about 6.4
+  REQUIRE(cosine_rmse < 0.5 * uniform_rmse);
+  REQUIRE(cosine_rmse == Approx(std::sqrt(1.0 / 18 / sample_per_pixel))
+                             .epsilon(0.1));
+}
+
+TEST_CASE("GGX microfacet materials", "[Material]")
+{
+  const Conductor conductor{Color(1, 1, 1), 0.5f};
+  const Rough_dielectric glass{Color(1, 1, 1), 0.3f, 1.5f};
+  const Material* material =
+      GENERATE_REF(as<const Material*>{}, &conductor, &glass);
+  const Vec3f wo = GENERATE(normalize(Vec3f{1, 0, 2}),
+                            normalize(Vec3f{-1, 1, -3}));
+
+  SECTION("Sampled values agree with eval and pdf")
+  {
+    for (std::uint64_t i = 0; i < 200; ++i) {
+      Sampler sampler{0, i, 0};
+      const auto s = material->sample(wo, up_facing, sampler);
+      if (!s) {
+        continue;
+      }
+      REQUIRE_FALSE(s->is_specular);
+      CHECK(s->pdf ==
+            Approx(material->pdf(wo, s->wi, up_facing)).epsilon(1e-3));
+      CHECK(s->f.r ==
+            Approx(material->eval(wo, s->wi, up_facing).r).epsilon(1e-3));
+    }
+  }
+
+  SECTION("The density integrates to at most one over the sphere")
+  {
+    constexpr int count = 200000;
+    double integral = 0;
+    for (std::uint64_t i = 0; i < count; ++i) {
+      Sampler sampler{2, i, 0};
+      const auto wi = uniform_sample_sphere(sampler.next_2d());
+      integral += material->pdf(wo, wi, up_facing) / uniform_sphere_pdf();
+    }
+    REQUIRE(integral / count < 1.02);
+    REQUIRE(integral / count > 0.8);
+  }
+}
+
+// A white material lit by a uniform white environment should reflect close
+// to all of the light it receives. Radiance refracted into glass is
+// compressed into a smaller solid angle, so transmitted samples are scaled
+// back by eta^2 to count energy.
+TEST_CASE("GGX materials conserve energy in a white furnace", "[Material]")
+{
+  const Conductor conductor{Color(1, 1, 1), 0.3f};
+  const Rough_dielectric glass{Color(1, 1, 1), 0.3f, 1.5f};
+  const Vec3f wo = normalize(Vec3f{1, 0, 2});
+
+  for (const Material* material : {static_cast<const Material*>(&conductor),
+                                   static_cast<const Material*>(&glass)}) {
+    constexpr int count = 100000;
+    double albedo = 0;
+    for (std::uint64_t i = 0; i < count; ++i) {
+      Sampler sampler{3, i, 0};
+      if (const auto s = material->sample(wo, up_facing, sampler)) {
+        const float energy_scale = s->wi.z < 0 ? 1.5f * 1.5f : 1.f;
+        albedo += s->f.r * std::abs(s->wi.z) / s->pdf * energy_scale;
+      }
+    }
+    REQUIRE(albedo / count > 0.9);
+    REQUIRE(albedo / count < 1.01);
+  }
+}
@@ -0,0 +1,326 @@
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "bounding_volume_hierarchy.hpp"
+#include "camera.hpp"
+#include "film.hpp"
+#include "image.hpp"
+#include "material.hpp"
+#include "pathtracer.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+#include "texture.hpp"
+#include "texture_cache.hpp"
+
+namespace {
+const Lambertian diffuse{Color(0.5f, 0.5f, 0.5f)};
+const Dielectric glass{Color(1, 1, 1), 0, 1.5f};
+const Emission light{Color(4, 4, 4)};
+
+Scene test_scene()
+{
+  Arena arena;
+  std::vector<Hitable*> objects;
+  objects.push_back(arena.create<Sphere>(Point3f{0, 0, -3}, 1, diffuse));
+  objects.push_back(arena.create<Sphere>(Point3f{1, 0, -2}, 0.5f, glass));
+  objects.push_back(arena.create<Sphere>(Point3f{0, 3, -3}, 1, light));
+  const auto bvh =
+      arena.create<BVH_node>(arena, objects.begin(), objects.end());
+  return Scene(std::move(arena), *bvh);
+}
+
+bool same_film(const Film& lhs, const Film& rhs)
+{
+  for (size_t y = 0; y < lhs.height(); ++y) {
+    for (size_t x = 0; x < lhs.width(); ++x) {
+      if (!(lhs.sum_at(x, y) == rhs.sum_at(x, y)) ||
+          lhs.sample_count_at(x, y) != rhs.sample_count_at(x, y)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool same_image(const Image& lhs, const Image& rhs)
+{
+  for (size_t y = 0; y < lhs.height(); ++y) {
+    for (size_t x = 0; x < lhs.width(); ++x) {
+      if (!(lhs.color_at(x, y) == rhs.color_at(x, y))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+} // anonymous namespace
+
+TEST_CASE("Deterministic rendering", "[Integrator]")
+{
+  const auto scene = test_scene();
+  const Camera camera{{0, 0, 0}, {0, 0, -1}, {0, 1, 0}, 60.0_deg, 1.5f};
+
+  Render_settings single_thread;
+  single_thread.thread_count = 1;
+  Film single_threaded(48, 32, 5);
+  Path_tracer{single_thread}.run(scene, camera, single_threaded, 4);
+
+  SECTION("Output does not depend on the number of threads")
+  {
+    Render_settings settings;
+    settings.thread_count = 8;
+    Film multi_threaded(48, 32, 5);
+    Path_tracer{settings}.run(scene, camera, multi_threaded, 4);
+    REQUIRE(same_film(single_threaded, multi_threaded));
+  }
+
+  SECTION("Output does not depend on the tile size")
+  {
+    Render_settings settings;
+    settings.thread_count = 4;
+    settings.tile_size = 7;
+    Film small_tiles(48, 32, 5);
+    Path_tracer{settings}.run(scene, camera, small_tiles, 4);
+    REQUIRE(same_film(single_threaded, small_tiles));
+
+    Image image(48, 32), small_tile_image(48, 32);
+    Path_tracer{}.run(scene, camera, image, 2);
+    settings.tile_size = 5;
+    Path_tracer{settings}.run(scene, camera, small_tile_image, 2);
+    REQUIRE(same_image(image, small_tile_image));
+  }
+
+  SECTION("Rendering into an image replaces its pixels")
+  {
+    Render_settings settings;
+    settings.thread_count = 2;
+    settings.tile_size = 16;
+    Image image(48, 32), reused(48, 32);
+    Path_tracer path_tracer{settings};
+    path_tracer.run(scene, camera, image, 2);
+    for (size_t y = 0; y < 32; ++y) {
+      for (size_t x = 0; x < 48; ++x) {
+        reused.color_at(x, y) = Color(1, 2, 3);
+      }
+    }
+    path_tracer.run(scene, camera, reused, 2);
+    REQUIRE(same_image(image, reused));
+  }
+
+  SECTION("Output does not depend on the tile order")
+  {
+    for (const auto order :
+         {Tile_order::row_major, Tile_order::hilbert, Tile_order::spiral}) {
+      Render_settings settings;
+      settings.thread_count = 3;
+      settings.tile_size = 16;
+      settings.tile_order = order;
+      Film film(48, 32, 5);
+      Path_tracer{settings}.run(scene, camera, film, 4);
+      REQUIRE(same_film(single_threaded, film));
+    }
+  }
+
+  SECTION("Paths end after the maximum depth")
+  {
+    auto settings = single_thread;
+    settings.max_depth = 1;
+    Film direct_only(48, 32, 5);
+    Path_tracer{settings}.run(scene, camera, direct_only, 4);
+    REQUIRE_FALSE(same_film(single_threaded, direct_only));
+
+    settings.max_depth = 0;
+    Film no_bounce(48, 32, 5);
+    Path_tracer{settings}.run(scene, camera, no_bounce, 4);
+    Image black(48, 32);
+    no_bounce.develop(black);
+    REQUIRE(same_image(black, Image(48, 32)));
+  }
+
+  SECTION("Output depends on the seed")
+  {
+    Film other_seed(48, 32, 6);
+    Path_tracer{single_thread}.run(scene, camera, other_seed, 4);
+    REQUIRE_FALSE(same_film(single_threaded, other_seed));
+  }
+
+  SECTION("Renders of sample ranges merge into the whole render")
+  {
+    Render_settings settings;
+    settings.thread_count = 4;
+    Path_tracer path_tracer{settings};
+    Film whole(48, 32, 5);
+    path_tracer.run(scene, camera, whole, 20);
+
+    Film first(48, 32, 5);
+    path_tracer.run(scene, camera, first, 7);
+    Film second(48, 32, 5, 7);
+    path_tracer.run(scene, camera, second, 20);
+    first.merge(second);
+    REQUIRE(same_film(whole, first));
+  }
+}
+
+TEST_CASE("Rendering several views of a scene", "[Integrator]")
+{
+  const auto scene = test_scene();
+  const Camera left{{-0.1f, 0, 0}, {-0.1f, 0, -1}, {0, 1, 0}, 60.0_deg, 1.5f};
+  const Camera right{{0.1f, 0, 0}, {0.1f, 0, -1}, {0, 1, 0}, 60.0_deg, 1};
+
+  Render_settings settings;
+  settings.seed = 3;
+  settings.thread_count = 4;
+  Path_tracer path_tracer{settings};
+  Image left_image(48, 32);
+  Image right_image(40, 40);
+  path_tracer.run(scene, {Render_job{left, left_image, 2},
+                          Render_job{right, right_image, 3}});
+
+  SECTION("Each view is the same as when rendered alone")
+  {
+    Image left_alone(48, 32);
+    path_tracer.run(scene, left, left_alone, 2);
+    REQUIRE(same_image(left_image, left_alone));
+
+    Image right_alone(40, 40);
+    path_tracer.run(scene, right, right_alone, 3);
+    REQUIRE(same_image(right_image, right_alone));
+  }
+}
+
+TEST_CASE("Rendering within a deadline", "[Integrator]")
+{
+  const auto scene = test_scene();
+  const Camera camera{{0, 0, 0}, {0, 0, -1}, {0, 1, 0}, 60.0_deg, 1.5f};
+  Render_settings settings;
+  settings.seed = 1;
+  settings.thread_count = 2;
+  Path_tracer path_tracer{settings};
+  Image image(48, 32);
+
+  SECTION("Stops at the maximum number of samples")
+  {
+    const auto deadline = Render_clock::now() + std::chrono::hours{1};
+    REQUIRE(path_tracer.run(scene, camera, image, deadline, 20) == 20);
+
+    Film film(48, 32, 1);
+    path_tracer.run(scene, camera, film, 20);
+    Image expected(48, 32);
+    film.develop(expected);
+    REQUIRE(same_image(image, expected));
+  }
+
+  SECTION("Stops before the deadline")
+  {
+    // Far more samples than fit in the budget, so the deadline ends the
+    // render. The time bound only catches a deadline that is ignored, a
+    // loaded machine may overshoot it by a whole pass.
+    const size_t max_sample_per_pixel = 1 << 20;
+    const auto start = Render_clock::now();
+    const auto budget = std::chrono::milliseconds{100};
+    const auto sample_per_pixel = path_tracer.run(
+        scene, camera, image, start + budget, max_sample_per_pixel);
+    REQUIRE(sample_per_pixel < max_sample_per_pixel);
+    REQUIRE(Render_clock::now() - start < budget + std::chrono::seconds{10});
+  }
+
+  SECTION("Renders nothing after the deadline")
+  {
+    REQUIRE(path_tracer.run(scene, camera, image, Render_clock::now()) == 0);
+    REQUIRE(same_image(image, Image(48, 32)));
+  }
+}
+
+TEST_CASE("Progress and cancellation", "[Integrator]")
+{
+  const auto scene = test_scene();
+  const Camera camera{{0, 0, 0}, {0, 0, -1}, {0, 1, 0}, 60.0_deg, 1.5f};
+  Render_settings settings;
+  settings.seed = 1;
+  settings.thread_count = 2;
+  settings.tile_size = 16;
+  Path_tracer path_tracer{settings};
+  Image image(48, 32);
+
+  std::vector<Render_progress> reports;
+  path_tracer.set_progress_callback(
+      [&](const Render_progress& progress) { reports.push_back(progress); });
+
+  SECTION("Reports every tile and sample")
+  {
+    // The last tiles are split for the idle thread
+    path_tracer.run(scene, camera, image, 4);
+    REQUIRE(reports.size() > 6);
+    REQUIRE(reports.back().tiles_done == reports.size());
+    REQUIRE(reports.back().samples_done == 48 * 32 * 4);
+    REQUIRE(reports.back().fraction == 1);
+
+    // Passes of 16 and 4 samples per pixel
+    reports.clear();
+    Film film(48, 32, 1);
+    path_tracer.run(scene, camera, film, 20);
+    REQUIRE(reports.size() > 12);
+    REQUIRE(reports.back().tiles_done == reports.size());
+    REQUIRE(reports.back().samples_done == 48 * 32 * 20);
+    for (size_t i = 1; i < reports.size(); ++i) {
+      REQUIRE(reports[i].fraction >= reports[i - 1].fraction);
+    }
+    REQUIRE(reports.back().fraction == 1);
+    REQUIRE(reports.back().remaining().count() == 0);
+  }
+
+  SECTION("Stops the render once cancelled")
+  {
+    Cancellation_token token;
+    path_tracer.set_cancellation_token(token);
+    path_tracer.set_progress_callback(
+        [&token](const Render_progress&) { token.cancel(); });
+
+    Film film(48, 32, 1);
+    REQUIRE_THROWS_AS(path_tracer.run(scene, camera, film, 20),
+                      Render_cancelled);
+    REQUIRE(film.min_sample_count() == 0);
+    REQUIRE_THROWS_AS(path_tracer.run(scene, camera, image, 4),
+                      Render_cancelled);
+    REQUIRE(same_image(image, Image(48, 32)));
+
+    // A new token lets the path tracer render again
+    path_tracer.set_cancellation_token({});
+    path_tracer.set_progress_callback({});
+    path_tracer.run(scene, camera, image, 4);
+    REQUIRE_FALSE(same_image(image, Image(48, 32)));
+  }
+}
+
+TEST_CASE("Texture errors reach the caller of run", "[Integrator]")
+{
+  const std::string filename = "pathtracer_test_texture.ppm";
+  {
+    std::ofstream os{filename, std::ios::binary};
+    os << "P5\n1 1\n255\n" << '\x80';
+  }
+  Texture_cache cache{1 << 20};
+  const Image_texture texture{cache, filename};
+  const Lambertian textured{texture};
+
+  Arena arena;
+  std::vector<Hitable*> objects;
+  objects.push_back(arena.create<Sphere>(Point3f{0, 0, -3}, 1, textured));
+  objects.push_back(arena.create<Sphere>(Point3f{0, 3, -3}, 1, light));
+  const auto bvh =
+      arena.create<BVH_node>(arena, objects.begin(), objects.end());
+  const Scene scene(std::move(arena), *bvh);
+
+  // The texels are read on first use, after the file is gone
+  std::remove(filename.c_str());
+  const Camera camera{{0, 0, 0}, {0, 0, -1}, {0, 1, 0}, 60.0_deg, 1.5f};
+  Image image(24, 16);
+  Render_settings settings;
+  settings.seed = 1;
+  settings.thread_count = 2;
+  Path_tracer path_tracer{settings};
+  REQUIRE_THROWS_AS(path_tracer.run(scene, camera, image, 1),
+                    std::runtime_error);
+}
@@ -0,0 +1,53 @@
+#include <catch2/catch.hpp>
+
+#include "random.hpp"
+
+TEST_CASE("PCG32", "[Sampling]")
+{
+  SECTION("Matches the reference implementation")
+  {
+    // First outputs of pcg32-demo seeded with (42, 54)
+    Pcg32 rng{42, 54};
+    REQUIRE(rng.next() == 0xa15c02b7);
+    REQUIRE(rng.next() == 0x7b47f409);
+    REQUIRE(rng.next() == 0xba1d3330);
+    REQUIRE(rng.next() == 0x83d2f293);
+  }
+
+  SECTION("Different streams give different sequences")
+  {
+    Pcg32 a{42, 1};
+    Pcg32 b{42, 2};
+    REQUIRE(a.next() != b.next());
+  }
+
+  SECTION("Floats are in [0, 1)")
+  {
+    Pcg32 rng;
+    for (int i = 0; i < 1000; ++i) {
+      const float x = rng.next_float();
+      REQUIRE(x >= 0);
+      REQUIRE(x < 1);
+    }
+  }
+}
+
+TEST_CASE("Philox4x32-10", "[Sampling]")
+{
+  // Known answer tests of the Random123 library
+  SECTION("Zero counter and key")
+  {
+    const auto result = Philox4x32::generate({0, 0, 0, 0}, {0, 0});
+    REQUIRE(result == Philox4x32::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                          0x9b00dbd8});
+  }
+
+  SECTION("All ones counter and key")
+  {
+    const auto result = Philox4x32::generate(
+        {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+        {0xffffffff, 0xffffffff});
+    REQUIRE(result == Philox4x32::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                                          0x6d5451fd});
+  }
+}
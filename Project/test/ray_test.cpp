@@ -19,6 +19,13 @@ TEST_CASE("Ray", "[geometry]")
 
     REQUIRE(ray.origin == origin);
     REQUIRE(ray.direction == direction);
+    REQUIRE(ray.time == 0);
+  }
+
+  SECTION("Construct a ray cast at a time")
+  {
+    Ray ray{origin, direction, 0.25f};
+    REQUIRE(ray.time == 0.25f);
   }
 
   SECTION("Gets correct point at parameter t from the ray function")
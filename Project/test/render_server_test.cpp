@@ -0,0 +1,120 @@
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "bounding_volume_hierarchy.hpp"
+#include "image.hpp"
+#include "material.hpp"
+#include "render_server.hpp"
+#include "sphere.hpp"
+
+namespace {
+const Lambertian diffuse{Color(0.5f, 0.5f, 0.5f)};
+const Emission light{Color(4, 4, 4)};
+
+Scene test_scene()
+{
+  Arena arena;
+  std::vector<Hitable*> objects;
+  objects.push_back(arena.create<Sphere>(Point3f{0, 0, -3}, 1, diffuse));
+  objects.push_back(arena.create<Sphere>(Point3f{0, 3, -3}, 1, light));
+  const auto bvh =
+      arena.create<BVH_node>(arena, objects.begin(), objects.end());
+  return Scene(std::move(arena), *bvh);
+}
+
+Render_request preview(const std::string& scene, const std::string& output)
+{
+  Render_request request;
+  request.scene = scene;
+  request.output = output;
+  request.width = 24;
+  request.height = 16;
+  return request;
+}
+} // anonymous namespace
+
+TEST_CASE("Render server", "[Integrator]")
+{
+  size_t loads = 0;
+  const auto loader = [&](const std::string& name) {
+    if (name == "unknown") {
+      throw std::invalid_argument{"Unknown scene " + name};
+    }
+    ++loads;
+    return test_scene();
+  };
+  Render_settings settings;
+  settings.thread_count = 2;
+  Render_server server{loader, 2, settings};
+
+  SECTION("Keeps the most recently used scenes in memory")
+  {
+    Image image(24, 16);
+    for (const auto name : {"a", "b", "a", "c", "a", "b"}) {
+      server.render(preview(name, {}), image);
+    }
+    REQUIRE(loads == 4);
+    REQUIRE(server.scene_misses() == 4);
+    REQUIRE(server.scene_hits() == 2);
+
+    REQUIRE_THROWS_AS(server.render(preview("unknown", {}), image),
+                      std::invalid_argument);
+    server.render(preview("a", {}), image);
+    REQUIRE(server.scene_hits() == 3);
+  }
+
+  SECTION("Serves requests over a socket until asked to stop")
+  {
+    const std::string socket_path = "render_server_test.sock";
+    const std::string output = "render_server_test.png";
+    std::thread serving{[&] { server.serve(socket_path); }};
+
+    Render_reply reply;
+    for (bool sent = false; !sent;) {
+      try {
+        reply = send_render_request(socket_path, preview("a", output));
+        sent = true;
+      }
+      catch (const std::runtime_error&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+      }
+    }
+    REQUIRE(reply.ok);
+    REQUIRE(std::ifstream{output}.good());
+    std::remove(output.c_str());
+
+    reply = send_render_request(socket_path, preview("unknown", output));
+    REQUIRE_FALSE(reply.ok);
+    REQUIRE(reply.message == "Unknown scene unknown");
+
+    reply = send_render_request(socket_path, preview("a", "output.ppm"));
+    REQUIRE_FALSE(reply.ok);
+
+    // Frames too large to allocate, including sizes whose product wraps
+    for (const auto& [width, height] :
+         {std::pair<size_t, size_t>{size_t{1} << 40, 1},
+          {size_t{1} << 32, size_t{1} << 32},
+          {40000, 40000}}) {
+      auto request = preview("a", output);
+      request.width = width;
+      request.height = height;
+      reply = send_render_request(socket_path, request);
+      REQUIRE_FALSE(reply.ok);
+      REQUIRE(reply.message == "Malformed request");
+    }
+    auto endless = preview("a", output);
+    endless.sample_per_pixel = size_t{1} << 40;
+    reply = send_render_request(socket_path, endless);
+    REQUIRE_FALSE(reply.ok);
+    REQUIRE(reply.message == "Malformed request");
+
+    send_stop_request(socket_path);
+    serving.join();
+    REQUIRE(server.scene_hits() == 1);
+    REQUIRE(loads == 1);
+  }
+}
@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+
+#include "sampler.hpp"
+
+TEST_CASE("Sampler", "[Sampling]")
+{
+  SECTION("Same seed, pixel and sample give the same sequence")
+  {
+    Sampler a{1, 2, 3};
+    Sampler b{1, 2, 3};
+    for (int i = 0; i < 16; ++i) {
+      REQUIRE(a.next_1d() == b.next_1d());
+    }
+    REQUIRE(a.dimension() == 16);
+  }
+
+  SECTION("Changing any of seed, pixel or sample changes the sequence")
+  {
+    const float reference = Sampler{1, 2, 3}.next_1d();
+    REQUIRE(Sampler{0, 2, 3}.next_1d() != reference);
+    REQUIRE(Sampler{1, 0, 3}.next_1d() != reference);
+    REQUIRE(Sampler{1, 2, 0}.next_1d() != reference);
+  }
+
+  SECTION("Numbers are uniformly distributed in [0, 1)")
+  {
+    constexpr int count = 100000;
+    double sum = 0;
+    float min = 1, max = 0;
+    for (int i = 0; i < count; ++i) {
+      Sampler sampler{7, static_cast<std::uint64_t>(i), 0};
+      const float x = sampler.next_1d();
+      min = std::min(min, x);
+      max = std::max(max, x);
+      sum += x;
+    }
+    REQUIRE(min >= 0);
+    REQUIRE(max < 1);
+    REQUIRE(sum / count == Approx(0.5).margin(0.01));
+  }
+}
@@ -0,0 +1,55 @@
+#include <catch2/catch.hpp>
+
+#include "random.hpp"
+#include "sampling.hpp"
+
+TEST_CASE("Sample warping", "[Sampling]")
+{
+  Pcg32 rng;
+  const auto next_2d = [&rng] {
+    const float x = rng.next_float();
+    const float y = rng.next_float();
+    return Point2f{x, y};
+  };
+  constexpr int count = 10000;
+
+  SECTION("Concentric disk samples lie on the unit disk")
+  {
+    float max_radius_square = 0;
+    for (int i = 0; i < count; ++i) {
+      const auto p = concentric_sample_disk(next_2d());
+      max_radius_square = std::max(max_radius_square, p.x * p.x + p.y * p.y);
+    }
+    REQUIRE(max_radius_square <= Approx(1));
+  }
+
+  SECTION("Sphere samples are unit vectors with zero mean")
+  {
+    Vec3f sum{0, 0, 0};
+    for (int i = 0; i < count; ++i) {
+      const auto v = uniform_sample_sphere(next_2d());
+      REQUIRE(v.length() == Approx(1));
+      sum += v;
+    }
+    REQUIRE((sum / static_cast<float>(count)).length() < 0.05f);
+  }
+
+  SECTION("Ball samples lie inside the unit sphere")
+  {
+    for (int i = 0; i < count; ++i) {
+      const auto p = next_2d();
+      REQUIRE(uniform_sample_ball(p, rng.next_float()).length() <= 1.0001f);
+    }
+  }
+
+  SECTION("Cosine hemisphere samples have E[cos] = 2/3")
+  {
+    double sum = 0;
+    for (int i = 0; i < count; ++i) {
+      const auto v = cosine_sample_hemisphere(next_2d());
+      REQUIRE(v.z >= 0);
+      sum += v.z;
+    }
+    REQUIRE(sum / count == Approx(2.0 / 3).margin(0.01));
+  }
+}
@@ -0,0 +1,197 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "arena.hpp"
+#include "axis_aligned_rect.hpp"
+#include "bounding_volume_hierarchy.hpp"
+#include "compressed_bvh.hpp"
+#include "instance.hpp"
+#include "random.hpp"
+#include "scene_cache.hpp"
+#include "sphere.hpp"
+
+namespace {
+const Lambertian red{Color(0.65f, 0.05f, 0.05f)};
+const Lambertian white{Color(0.73f, 0.73f, 0.73f)};
+const std::vector<const Material*> palette{&red, &white};
+constexpr float inf = std::numeric_limits<float>::infinity();
+
+std::vector<Hitable*> make_primitives(Arena& arena)
+{
+  Pcg32 rng;
+  std::vector<Hitable*> primitives;
+  for (int i = 0; i < 200; ++i) {
+    const Point3f center{10 * rng.next_float(), 10 * rng.next_float(),
+                         10 * rng.next_float()};
+    primitives.push_back(
+        arena.create<Sphere>(center, 0.3f, i % 2 == 0 ? red : white));
+  }
+  primitives.push_back(arena.create<Sphere>(
+      Point3f{5, 5, 5}, Point3f{6, 5, 5}, 1, white));
+  primitives.push_back(arena.create<Rect_XZ>(
+      Point2f(0, 0), Point2f(10, 10), 0, white, Normal_Direction::Negetive));
+  primitives.push_back(
+      arena.create<Rect_XY>(Point2f(0, 0), Point2f(10, 10), 10, red));
+  primitives.push_back(
+      arena.create<Rect_YZ>(Point2f(0, 0), Point2f(10, 10), 10, red));
+  return primitives;
+}
+} // anonymous namespace
+
+TEST_CASE("Scene cache", "[Scene]")
+{
+  const std::string filename = "scene_cache_test.ptsc";
+
+  Arena arena;
+  auto primitives = make_primitives(arena);
+  const auto key = scene_content_key(primitives, palette);
+  // Building reorders the list, the cache refers to the scene order
+  auto order = primitives;
+  const auto bvh = arena.create<BVH_node>(arena, order.begin(), order.end());
+  const Compressed_BVH built{arena, *bvh};
+  write_scene_cache(filename, key, built, primitives, palette);
+
+  SECTION("A loaded scene finds the same hits as the built one")
+  {
+    Arena cache_arena;
+    const auto cached =
+        load_scene_cache(filename, key, cache_arena, primitives, palette);
+    REQUIRE(cached);
+    REQUIRE(*cached->aggregate->bounding_box() == *built.bounding_box());
+    REQUIRE(cached->aggregate->node_count() == built.node_count());
+
+    Pcg32 rng{7};
+    int hit_count = 0;
+    for (int i = 0; i < 500; ++i) {
+      const Ray ray{{10 * rng.next_float(), 10 * rng.next_float(), -1},
+                    {rng.next_float() - 0.5f, rng.next_float() - 0.5f, 1},
+                    rng.next_float()};
+      const auto expected = built.intersect_at(ray, 0.001f, inf);
+      const auto actual = cached->aggregate->intersect_at(ray, 0.001f, inf);
+      REQUIRE(actual.has_value() == expected.has_value());
+      if (expected) {
+        ++hit_count;
+        REQUIRE(actual->t == expected->t);
+        const auto expected_hit =
+            expected->surface_owner().surface_at(ray, *expected);
+        const auto actual_hit =
+            actual->surface_owner().surface_at(ray, *actual);
+        REQUIRE(actual_hit.point == expected_hit.point);
+        REQUIRE(actual_hit.normal == expected_hit.normal);
+        REQUIRE(actual_hit.material == expected_hit.material);
+      }
+    }
+    REQUIRE(hit_count > 100);
+  }
+
+  SECTION("A loaded scene uses the primitives of the scene")
+  {
+    Arena cache_arena;
+    const auto cached =
+        load_scene_cache(filename, key, cache_arena, primitives, palette);
+    REQUIRE(cached);
+    const auto aggregate = cached->aggregate;
+    REQUIRE(aggregate->primitive_count() == primitives.size());
+    for (size_t i = 0; i < aggregate->primitive_count(); ++i) {
+      REQUIRE(aggregate->primitives()[i] == built.primitives()[i]);
+    }
+    REQUIRE(cache_arena.bytes_used() <
+            sizeof(Compressed_BVH) + (primitives.size() + 2) * sizeof(void*));
+  }
+
+  SECTION("Another primitive list ignores the cache")
+  {
+    auto reversed = primitives;
+    std::reverse(reversed.begin(), reversed.end());
+    Arena cache_arena;
+    REQUIRE_FALSE(
+        load_scene_cache(filename, key, cache_arena, reversed, palette));
+  }
+
+  SECTION("Changed content gives another key and ignores the cache")
+  {
+    dynamic_cast<Sphere*>(primitives[3])->center.x += 0.01f;
+    const auto changed_key = scene_content_key(primitives, palette);
+    REQUIRE(changed_key != key);
+
+    Arena cache_arena;
+    REQUIRE_FALSE(load_scene_cache(filename, changed_key, cache_arena,
+                                   primitives, palette));
+  }
+
+  SECTION("Missing and truncated files are ignored")
+  {
+    Arena cache_arena;
+    REQUIRE_FALSE(load_scene_cache("no_such_cache.ptsc", key, cache_arena,
+                                   primitives, palette));
+
+    {
+      std::ofstream truncated{filename, std::ios::binary | std::ios::app};
+      truncated << "extra";
+    }
+    REQUIRE_FALSE(
+        load_scene_cache(filename, key, cache_arena, primitives, palette));
+  }
+
+  SECTION("Files with nodes out of range are ignored")
+  {
+    using Node = Compressed_BVH::Node;
+    constexpr size_t header_size = 64;
+    const auto corrupt = [&](size_t node, size_t offset, const auto& value) {
+      std::fstream file{filename,
+                        std::ios::binary | std::ios::in | std::ios::out};
+      file.seekp(static_cast<std::streamoff>(header_size +
+                                             node * sizeof(Node) + offset));
+      file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    Arena cache_arena;
+
+    SECTION("Too many children")
+    {
+      corrupt(0, offsetof(Node, child_count), std::uint8_t{5});
+    }
+    SECTION("A child past the last node")
+    {
+      corrupt(0, offsetof(Node, children),
+              static_cast<std::uint32_t>(built.node_count()));
+    }
+    SECTION("A child before its parent")
+    {
+      const auto last = built.node_count() - 1;
+      corrupt(last, offsetof(Node, children), std::uint32_t{0});
+    }
+    SECTION("A leaf past the last primitive")
+    {
+      corrupt(0, offsetof(Node, children),
+              static_cast<std::uint32_t>(primitives.size()) |
+                  Compressed_BVH::leaf_bit);
+    }
+    SECTION("A path longer than a Compressed_BVH may be")
+    {
+      const auto depth = Compressed_BVH::max_depth + 1;
+      REQUIRE(built.node_count() >= depth);
+      for (size_t i = 0; i + 1 < depth; ++i) {
+        corrupt(i, offsetof(Node, child_count), std::uint8_t{1});
+        corrupt(i, offsetof(Node, children), static_cast<std::uint32_t>(i + 1));
+      }
+    }
+    REQUIRE_FALSE(
+        load_scene_cache(filename, key, cache_arena, primitives, palette));
+  }
+
+  SECTION("Unsupported primitives are rejected")
+  {
+    const Instance instance{*primitives[0], Transform{}};
+    primitives.push_back(const_cast<Instance*>(&instance));
+    REQUIRE_THROWS_AS(scene_content_key(primitives, palette),
+                      std::invalid_argument);
+  }
+
+  std::remove(filename.c_str());
+}
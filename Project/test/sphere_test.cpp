@@ -49,3 +49,38 @@ TEST_CASE("Ray-Sphere intersection", "[geometry]")
     REQUIRE(result->t == Approx(2));
   }
 }
+
+TEST_CASE("Surface data of a ray-sphere intersection", "[geometry]")
+{
+  Sphere sphere{{0, 0, 2}, 1, dummy_mat};
+  const Ray ray({0, 0, 0}, {0, 0, 1});
+  const auto intersection = sphere.intersect_at(ray, 0, inf);
+  REQUIRE(intersection);
+  REQUIRE(intersection->object == &sphere);
+
+  const auto record = sphere.surface_at(ray, *intersection);
+  REQUIRE(record.t == Approx(1));
+  REQUIRE(record.point.z == Approx(1));
+  REQUIRE(record.normal.z == Approx(-1));
+  REQUIRE(record.material == &dummy_mat);
+  REQUIRE(record.uv.y == Approx(0.5f));
+  REQUIRE(dot(record.dpdu, record.normal) == Approx(0).margin(1e-5));
+  REQUIRE(dot(record.dpdv, record.normal) == Approx(0).margin(1e-5));
+  REQUIRE(dot(cross(record.dpdu, record.dpdv), record.normal) > 0);
+}
+
+TEST_CASE("Moving sphere", "[geometry]")
+{
+  Sphere sphere{{0, 0, 2}, {4, 0, 2}, 1, dummy_mat};
+  REQUIRE(*sphere.bounding_box() == AABB({-1, -1, 1}, {5, 1, 3}));
+  REQUIRE(*sphere.bounding_box_at(0.5f) == AABB({1, -1, 1}, {3, 1, 3}));
+
+  const Ray early({2, 0, 0}, {0, 0, 1}, 0);
+  REQUIRE_FALSE(sphere.intersect_at(early, 0, inf));
+
+  const Ray middle({2, 0, 0}, {0, 0, 1}, 0.5f);
+  const auto intersection = sphere.intersect_at(middle, 0, inf);
+  REQUIRE(intersection);
+  REQUIRE(intersection->t == Approx(1));
+  REQUIRE(sphere.surface_at(middle, *intersection).normal.z == Approx(-1));
+}
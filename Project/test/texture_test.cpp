@@ -0,0 +1,165 @@
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "texture.hpp"
+#include "texture_cache.hpp"
+
+namespace {
+Hit_record hit_at(float u, float v, float footprint = 0)
+{
+  return Hit_record{0, {}, {}, nullptr, Point2f{u, v}, footprint};
+}
+
+Color pattern(size_t x, size_t y)
+{
+  return Color{static_cast<float>(x), static_cast<float>(y), 1};
+}
+
+// Writes a little-endian PFM whose texel (x, y) is pattern(x, y)
+void write_pfm(const std::string& filename, size_t width, size_t height)
+{
+  std::ofstream os{filename, std::ios::binary};
+  os << "PF\n" << width << ' ' << height << "\n-1\n";
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      const auto c = pattern(x, y);
+      for (const float value : {c.r, c.g, c.b}) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 4; ++i) {
+          os.put(static_cast<char>((bits >> (8 * i)) & 0xFFu));
+        }
+      }
+    }
+  }
+}
+} // anonymous namespace
+
+TEST_CASE("Constant and checker textures", "[Graphics]")
+{
+  const Constant_texture white{Color{1, 1, 1}};
+  const Constant_texture black{Color{}};
+  REQUIRE(white.value(hit_at(0.3f, 0.7f)) == Color(1, 1, 1));
+
+  const Checker_texture checker{white, black, 4};
+  REQUIRE(checker.value(hit_at(0.1f, 0.1f)) == Color(1, 1, 1));
+  REQUIRE(checker.value(hit_at(0.3f, 0.1f)) == Color(0, 0, 0));
+  REQUIRE(checker.value(hit_at(0.3f, 0.3f)) == Color(1, 1, 1));
+}
+
+TEST_CASE("Texture cache", "[Graphics]")
+{
+  const std::string filename = "texture_test.pfm";
+  write_pfm(filename, 70, 40);
+
+  SECTION("Builds a mip pyramid down to 1x1")
+  {
+    Texture_cache cache{1 << 20};
+    const auto id = cache.add(filename);
+    REQUIRE(cache.level_count(id) == 7);
+    REQUIRE(cache.size(id, 0) == std::array<size_t, 2>{70, 40});
+    REQUIRE(cache.size(id, 1) == std::array<size_t, 2>{35, 20});
+    REQUIRE(cache.size(id, 6) == std::array<size_t, 2>{1, 1});
+  }
+
+  SECTION("Reads texels lazily, a tile at a time")
+  {
+    Texture_cache cache{1 << 20};
+    const auto id = cache.add(filename);
+    REQUIRE(cache.memory_used() == 0);
+
+    REQUIRE(cache.texel(id, 0, 0, 0) == pattern(0, 0));
+    REQUIRE(cache.texel(id, 0, 69, 39) == pattern(69, 39));
+    REQUIRE(cache.texel(id, 0, 33, 5) == pattern(33, 5));
+    REQUIRE(cache.texel(id, 0, 31, 31) == pattern(31, 31));
+    REQUIRE(cache.misses() == 3);
+    REQUIRE(cache.hits() == 1);
+  }
+
+  SECTION("Coarser levels average 2x2 texels")
+  {
+    Texture_cache cache{1 << 20};
+    const auto id = cache.add(filename);
+    REQUIRE(cache.texel(id, 1, 16, 3) == Color(32.5f, 6.5f, 1));
+    REQUIRE(cache.texel(id, 2, 0, 0) == Color(1.5f, 1.5f, 1));
+  }
+
+  SECTION("Stays within the memory budget")
+  {
+    const size_t tile_bytes =
+        Texture_cache::tile_size * Texture_cache::tile_size * sizeof(Color);
+    Texture_cache cache{2 * tile_bytes};
+    const auto id = cache.add(filename);
+    for (size_t y = 0; y < 40; y += 8) {
+      for (size_t x = 0; x < 70; x += 8) {
+        REQUIRE(cache.texel(id, 0, x, y) == pattern(x, y));
+        REQUIRE(cache.memory_used() <= cache.memory_budget());
+      }
+    }
+    REQUIRE(cache.texel(id, 4, 2, 1) == Color(39.5f, 23.5f, 1));
+    REQUIRE(cache.memory_used() <= cache.memory_budget());
+  }
+
+  SECTION("Image textures filter bilinearly and repeat")
+  {
+    Texture_cache cache{1 << 20};
+    const Image_texture texture{cache, filename};
+
+    // The center of texel (3, 2)
+    const auto center = texture.value(hit_at(3.5f / 70, 2.5f / 40));
+    REQUIRE(center.r == Approx(3));
+    REQUIRE(center.g == Approx(2));
+
+    const auto between = texture.value(hit_at(4.f / 70, 2.5f / 40));
+    REQUIRE(between.r == Approx(3.5f));
+
+    const auto wrapped = texture.value(hit_at(1 + 3.5f / 70, 2.5f / 40));
+    REQUIRE(wrapped.r == Approx(3));
+
+    // A footprint as wide as the texture reads the 1x1 level
+    const auto blurred = texture.value(hit_at(0.5f, 0.5f, 1));
+    REQUIRE(blurred == cache.texel(0, 6, 0, 0));
+  }
+
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("Texture cache reads 8 bit images", "[Graphics]")
+{
+  const std::string filename = "texture_test.ppm";
+  {
+    // Rows are stored top to bottom, values are gamma encoded
+    std::ofstream os{filename, std::ios::binary};
+    os << "P6\n# comment\n2 2\n255\n";
+    const unsigned char pixels[] = {255, 0, 0, 0,   255, 0,
+                                    0,   0, 255, 255, 255, 255};
+    os.write(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+  }
+
+  Texture_cache cache{1 << 20};
+  const auto id = cache.add(filename);
+  REQUIRE(cache.texel(id, 0, 0, 1) == Color(1, 0, 0));
+  REQUIRE(cache.texel(id, 0, 1, 0) == Color(1, 1, 1));
+  REQUIRE(cache.texel(id, 1, 0, 0) == Color(0.5f, 0.5f, 0.5f));
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("Texture cache rejects unreadable files", "[Graphics]")
+{
+  Texture_cache cache{1 << 20};
+  REQUIRE_THROWS_AS(cache.add("no_such_texture.pfm"), std::runtime_error);
+  REQUIRE_THROWS_AS(Image_texture(cache, "no_such_texture.pfm"),
+                    std::runtime_error);
+
+  const std::string filename = "texture_test_truncated.pfm";
+  {
+    std::ofstream os{filename, std::ios::binary};
+    os << "PF\n4 4\n-1\n";
+  }
+  REQUIRE_THROWS_AS(cache.add(filename), std::runtime_error);
+  std::remove(filename.c_str());
+}
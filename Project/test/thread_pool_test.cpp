@@ -0,0 +1,38 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+TEST_CASE("Thread pool", "[Concurrency]")
+{
+  Thread_pool pool{4};
+  REQUIRE(pool.size() == 4);
+
+  SECTION("submit returns the result of the task")
+  {
+    auto result = pool.submit([] { return 42; });
+    REQUIRE(result.get() == 42);
+  }
+
+  SECTION("parallel_for visits every index exactly once")
+  {
+    std::vector<std::atomic<int>> visits(1000);
+    pool.parallel_for(visits.size(), [&](size_t i) { ++visits[i]; });
+    for (const auto& visit : visits) {
+      REQUIRE(visit == 1);
+    }
+  }
+
+  SECTION("parallel_for propagates exceptions")
+  {
+    REQUIRE_THROWS_AS(pool.parallel_for(10,
+                                        [](size_t i) {
+                                          if (i == 5) {
+                                            throw std::runtime_error{"5"};
+                                          }
+                                        }),
+                      std::runtime_error);
+  }
+}
@@ -0,0 +1,122 @@
+#include <catch2/catch.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+#include "tile_schedule.hpp"
+
+namespace {
+// Returns whether tiles cover every pixel of a width x height frame once
+bool covers_frame(const std::vector<Tile_rect>& tiles, size_t width,
+                  size_t height)
+{
+  std::vector<int> coverage(width * height);
+  for (const auto& tile : tiles) {
+    if (tile.width == 0 || tile.height == 0 || tile.x + tile.width > width ||
+        tile.y + tile.height > height) {
+      return false;
+    }
+    for (size_t y = tile.y; y < tile.y + tile.height; ++y) {
+      for (size_t x = tile.x; x < tile.x + tile.width; ++x) {
+        ++coverage[y * width + x];
+      }
+    }
+  }
+  for (const auto count : coverage) {
+    if (count != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<Tile_rect> drain(Tile_queue& queue)
+{
+  std::vector<Tile_rect> tiles;
+  while (const auto tile = queue.pop()) {
+    tiles.push_back(*tile);
+  }
+  return tiles;
+}
+} // anonymous namespace
+
+TEST_CASE("Tile order", "[Concurrency]")
+{
+  SECTION("Every order covers the frame")
+  {
+    for (const auto order :
+         {Tile_order::row_major, Tile_order::hilbert, Tile_order::spiral}) {
+      REQUIRE(covers_frame(ordered_tiles(100, 70, 16, order), 100, 70));
+      REQUIRE(covers_frame(ordered_tiles(16, 16, 16, order), 16, 16));
+    }
+  }
+
+  SECTION("Row major order goes row by row")
+  {
+    const auto tiles = ordered_tiles(40, 20, 16, Tile_order::row_major);
+    REQUIRE(tiles.size() == 6);
+    REQUIRE(tiles[1].x == 16);
+    REQUIRE(tiles[2].width == 8);
+    REQUIRE(tiles[3].y == 16);
+    REQUIRE(tiles[3].height == 4);
+  }
+
+  SECTION("Consecutive tiles of a Hilbert curve are neighbours")
+  {
+    const auto tiles = ordered_tiles(128, 128, 16, Tile_order::hilbert);
+    for (size_t i = 1; i < tiles.size(); ++i) {
+      const auto dx = std::abs(static_cast<long>(tiles[i].x) -
+                               static_cast<long>(tiles[i - 1].x));
+      const auto dy = std::abs(static_cast<long>(tiles[i].y) -
+                               static_cast<long>(tiles[i - 1].y));
+      REQUIRE(dx + dy == 16);
+    }
+  }
+
+  SECTION("A spiral starts at the center")
+  {
+    const auto tiles = ordered_tiles(112, 80, 16, Tile_order::spiral);
+    REQUIRE(tiles.front().x == 48);
+    REQUIRE(tiles.front().y == 32);
+    // The outermost ring ends left of the center
+    REQUIRE(tiles.back().x == 0);
+    REQUIRE(tiles.back().y == 32);
+  }
+}
+
+TEST_CASE("Tile queue", "[Concurrency]")
+{
+  const auto tiles = ordered_tiles(64, 64, 32, Tile_order::row_major);
+
+  SECTION("Tiles are taken as they are while there are enough of them")
+  {
+    Tile_queue queue{tiles, 1};
+    const auto taken = drain(queue);
+    REQUIRE(taken.size() == 4);
+    REQUIRE(taken[3].x == 32);
+    REQUIRE(taken[3].width == 32);
+  }
+
+  SECTION("The last tiles are split for idle workers")
+  {
+    Tile_queue queue{tiles, 4};
+    const auto taken = drain(queue);
+    REQUIRE(taken.size() > 4);
+    REQUIRE(covers_frame(taken, 64, 64));
+    for (const auto& tile : taken) {
+      REQUIRE(tile.width >= 8);
+      REQUIRE(tile.height >= 8);
+    }
+  }
+
+  SECTION("Split tiles keep their frame")
+  {
+    Tile_queue queue{{Tile_rect{0, 0, 20, 4, 3}}, 8, 4};
+    const auto taken = drain(queue);
+    REQUIRE(taken.size() > 1);
+    for (const auto& tile : taken) {
+      REQUIRE(tile.frame == 3);
+      REQUIRE(tile.height == 4);
+    }
+  }
+}
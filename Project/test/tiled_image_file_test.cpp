@@ -0,0 +1,58 @@
+#include <catch2/catch.hpp>
+#include <cstdio>
+
+#include "tiled_image_file.hpp"
+
+TEST_CASE("Tiled image file", "[Graphics]")
+{
+  const std::string filename = "tiled_image_file_test.ptti";
+
+  SECTION("Tiles written in any order assemble into the full image")
+  {
+    {
+      Tiled_image_writer writer(filename, 3, 2, 2);
+
+      Tile right{2, 0, 1, 2};
+      right.at(0, 0) = Color{0, 0, 1};
+      right.at(0, 1) = Color{0, 1, 1};
+      writer.write(right);
+
+      Tile left{0, 0, 2, 2};
+      left.at(0, 0) = Color{1, 0, 0};
+      left.at(1, 1) = Color{0, 1, 0};
+      writer.write(left);
+      writer.close();
+    }
+
+    const auto image = read_tiled_image(filename);
+    REQUIRE(image.width() == 3);
+    REQUIRE(image.height() == 2);
+    REQUIRE(image.color_at(0, 0) == Color(1, 0, 0));
+    REQUIRE(image.color_at(1, 0) == Color(0, 0, 0));
+    REQUIRE(image.color_at(1, 1) == Color(0, 1, 0));
+    REQUIRE(image.color_at(2, 0) == Color(0, 0, 1));
+    REQUIRE(image.color_at(2, 1) == Color(0, 1, 1));
+  }
+
+#ifdef __linux__
+  SECTION("Closing reports tiles that could not be written")
+  {
+    // Every write to /dev/full fails with ENOSPC, once the buffer is flushed
+    Tiled_image_writer writer("/dev/full", 3, 2, 2);
+    writer.write(Tile{0, 0, 2, 2});
+    REQUIRE_THROWS_AS(writer.close(), Cannot_write_file);
+  }
+#endif
+
+  SECTION("Reading a file that is not a tiled image throws")
+  {
+    {
+      std::FILE* file = std::fopen(filename.c_str(), "wb");
+      std::fputs("P6 1 1 255\n", file);
+      std::fclose(file);
+    }
+    REQUIRE_THROWS_AS(read_tiled_image(filename), std::runtime_error);
+  }
+
+  std::remove(filename.c_str());
+}
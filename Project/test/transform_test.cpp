@@ -0,0 +1,85 @@
+#include <catch2/catch.hpp>
+
+#include "transform.hpp"
+
+namespace {
+void require_near(Vec3f actual, Vec3f expected)
+{
+  REQUIRE(actual.x == Approx(expected.x).margin(1e-5));
+  REQUIRE(actual.y == Approx(expected.y).margin(1e-5));
+  REQUIRE(actual.z == Approx(expected.z).margin(1e-5));
+}
+
+void require_near(Point3f actual, Point3f expected)
+{
+  require_near(actual - Point3f{0, 0, 0}, expected - Point3f{0, 0, 0});
+}
+} // anonymous namespace
+
+TEST_CASE("Transform", "[math]")
+{
+  const auto translate = Transform::translate(Vec3f{1, 2, 3});
+  const auto scale = Transform::scale(Vec3f{2, 4, 8});
+  const auto rotate = Transform::rotate(Vec3f{0, 0, 1}, 90.0_deg);
+
+  SECTION("Translations move points but not vectors")
+  {
+    require_near(translate(Point3f{1, 1, 1}), Point3f{2, 3, 4});
+    require_near(translate(Vec3f{1, 1, 1}), Vec3f{1, 1, 1});
+  }
+
+  SECTION("Rotations are counterclockwise")
+  {
+    require_near(rotate(Vec3f{1, 0, 0}), Vec3f{0, 1, 0});
+  }
+
+  SECTION("Composition applies the right hand side first")
+  {
+    const auto combined = translate * scale;
+    require_near(combined(Point3f{1, 1, 1}), Point3f{3, 6, 11});
+  }
+
+  SECTION("Inverse undoes the transform")
+  {
+    const auto combined = rotate * translate * scale;
+    const Point3f p{0.5f, -2, 7};
+    require_near(combined.inverse()(combined(p)), p);
+  }
+
+  SECTION("Normals stay perpendicular to transformed tangents")
+  {
+    const auto combined = rotate * scale;
+    const Vec3f tangent{1, -1, 0};
+    const Vec3f normal{1, 1, 0};
+    REQUIRE(dot(combined(tangent), combined.normal(normal)) ==
+            Approx(0).margin(1e-5));
+  }
+
+  SECTION("Boxes are bounded after the transform")
+  {
+    const AABB box{{0, 0, 0}, {1, 1, 1}};
+    const auto rotated = rotate(box);
+    require_near(rotated.min(), Point3f{-1, 0, 0});
+    require_near(rotated.max(), Point3f{0, 1, 1});
+  }
+}
+
+TEST_CASE("Interpolated transforms", "[math]")
+{
+  const auto start = Transform::translate(Vec3f{0, 0, 0});
+  const auto end = Transform::translate(Vec3f{4, 0, 0}) *
+                   Transform::rotate(Vec3f{0, 1, 0}, 90.0_deg);
+  const auto middle = Transform::lerp(start, end, 0.5f);
+
+  const Point3f p{1, 2, 3};
+  const auto expected = lerp(start(p), end(p), 0.5f);
+  const auto moved = middle(p);
+  REQUIRE(moved.x == Approx(expected.x));
+  REQUIRE(moved.y == Approx(expected.y));
+  REQUIRE(moved.z == Approx(expected.z));
+
+  const auto back = middle.inverse()(moved);
+  REQUIRE(back.x == Approx(p.x));
+  REQUIRE(back.y == Approx(p.y));
+  REQUIRE(back.z == Approx(p.z));
+}
@@ -1,59 +1,110 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <random>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#ifndef _WIN32
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "distributed.hpp"
+#include "render_server.hpp"
+
+extern char** environ;
+#endif
+
+#include <indicators/progress_bar.hpp>
+
+#include "arena.hpp"
 #include "axis_aligned_rect.hpp"
 #include "bounding_volume_hierarchy.hpp"
+#include "compressed_bvh.hpp"
+#include "film.hpp"
 #include "image.hpp"
 #include "material.hpp"
 #include "pathtracer.hpp"
 #include "scene.hpp"
+#include "scene_cache.hpp"
 #include "sphere.hpp"
+#include "tiled_image_file.hpp"
 
-namespace {
-const Lambertian red{Color(0.65f, 0.05f, 0.05f)};
-const Lambertian white{Color(0.73f, 0.73f, 0.73f)};
-const Lambertian green{Color(0.12f, 0.45f, 0.15f)};
-const Emission light{Color(1, 1, 1)};
-const Metal metal{Color(0.73f, 0.73f, 0.73f), 0.8};
-const Dielectric glass(Color(1.f, 1.f, 1.f), 0.1, 1.655);
-} // namespace
-
-Scene create_scene()
+// Loads the BVH of the scene from cache_filename if it is set and fits the
+// scene. Otherwise the BVH is built and, if write_cache is set, stored there.
+Scene create_scene(const std::string& cache_filename, bool write_cache)
 {
-  std::vector<std::unique_ptr<Hitable>> objects;
-  std::vector<std::unique_ptr<Material>> materials;
+  Arena arena;
+  const auto& red = *arena.create<Lambertian>(Color(0.65f, 0.05f, 0.05f));
+  const auto& white = *arena.create<Lambertian>(Color(0.73f, 0.73f, 0.73f));
+  const auto& green = *arena.create<Lambertian>(Color(0.12f, 0.45f, 0.15f));
+  const auto& light = *arena.create<Emission>(Color(1, 1, 1));
+  const auto& metal =
+      *arena.create<Conductor>(Color(0.73f, 0.73f, 0.73f), 0.6f);
+  const auto& glass =
+      *arena.create<Rough_dielectric>(Color(1.f, 1.f, 1.f), 0.1f, 1.655f);
+
+  std::vector<Hitable*> objects;
 
-  objects.push_back(std::make_unique<Rect_YZ>(Point2f(0, 0), Point2f(555, 555),
-                                              555, green,
-                                              Normal_Direction::Negetive));
+  objects.push_back(arena.create<Rect_YZ>(Point2f(0, 0), Point2f(555, 555),
+                                          555, green,
+                                          Normal_Direction::Negetive));
   objects.push_back(
-      std::make_unique<Rect_YZ>(Point2f(0, 0), Point2f(555, 555), 0, red));
+      arena.create<Rect_YZ>(Point2f(0, 0), Point2f(555, 555), 0, red));
 
-  objects.push_back(std::make_unique<Rect_XZ>(Point2f(213, 227),
-                                              Point2f(343, 332), 554, light));
-  objects.push_back(std::make_unique<Rect_XZ>(Point2f(0, 0), Point2f(555, 555),
-                                              555, white,
-                                              Normal_Direction::Negetive));
+  objects.push_back(arena.create<Rect_XZ>(Point2f(213, 227), Point2f(343, 332),
+                                          554, light));
+  objects.push_back(arena.create<Rect_XZ>(Point2f(0, 0), Point2f(555, 555),
+                                          555, white,
+                                          Normal_Direction::Negetive));
   objects.push_back(
-      std::make_unique<Rect_XZ>(Point2f(0, 0), Point2f(555, 555), 0, white));
+      arena.create<Rect_XZ>(Point2f(0, 0), Point2f(555, 555), 0, white));
 
-  objects.push_back(std::make_unique<Rect_XY>(Point2f(0, 0), Point2f(555, 555),
-                                              555, white,
-                                              Normal_Direction::Negetive));
+  objects.push_back(arena.create<Rect_XY>(Point2f(0, 0), Point2f(555, 555),
+                                          555, white,
+                                          Normal_Direction::Negetive));
 
-  objects.push_back(
-      std::make_unique<Sphere>(Point3f{200, 100, 300}, 100, metal));
+  objects.push_back(arena.create<Sphere>(Point3f{200, 100, 300}, 100, metal));
 
-  objects.push_back(
-      std::make_unique<Sphere>(Point3f{300, 110, 100}, 100, glass));
+  objects.push_back(arena.create<Sphere>(Point3f{300, 110, 100}, 100, glass));
+
+  // The cache is only used if it was written for exactly these primitives,
+  // its leaves then refer to them
+  const std::vector<const Material*> palette{&red,   &white, &green,
+                                             &light, &metal, &glass};
+  std::uint64_t key = 0;
+  if (!cache_filename.empty()) {
+    key = scene_content_key(objects, palette);
+    if (auto cached =
+            load_scene_cache(cache_filename, key, arena, objects, palette)) {
+      const auto& aggregate = *cached->aggregate;
+      return Scene(std::move(arena), aggregate, std::move(cached->file));
+    }
+  }
 
-  return Scene(std::make_unique<BVH_node>(objects.begin(), objects.end()),
-               std::move(materials));
+  // Building reorders the list, the cache refers to the original order
+  auto order = objects;
+  const auto bvh = arena.create<BVH_node>(arena, order.begin(), order.end());
+  const auto compressed = arena.create<Compressed_BVH>(arena, *bvh);
+  if (!cache_filename.empty() && write_cache) {
+    try {
+      write_scene_cache(cache_filename, key, *compressed, objects, palette);
+    }
+    catch (const Cannot_write_file& e) {
+      std::cerr << "Cannot write the scene cache " << e.what() << '\n';
+    }
+  }
+  return Scene(std::move(arena), *compressed);
 }
 
 template <typename Duration>
@@ -73,30 +124,486 @@ void print_elapse_time(const Duration& elapsed_time)
   }
 }
 
-int main()
-try {
-  using namespace std::chrono;
+constexpr const char* usage = R"(Usage: PathTracer [OPTION]...
+Renders the Cornell box.
+
+Frame:
+  --width N             Width of the image in pixels (800)
+  --height N            Height of the image in pixels (600)
+  --spp N               Samples per pixel (500)
+  --output FILE         Output file (test.png). A .png file receives the
+                        image, a .ptfm file the film PathTracerMerge merges,
+                        a .ptti file the raw tiles of frames too large to
+                        hold in memory
+  --first-sample N      Only render the samples from N on into a .ptfm film
+  --time-budget MS      Stop adding samples before MS milliseconds elapsed,
+                        --spp is then the most samples per pixel
+
+Performance:
+  --threads N           Number of threads, 0 for one per hardware thread (0)
+  --tile-size N         Width and height of the tiles in pixels (32)
+  --tile-order ORDER    Order of the tiles: rows, hilbert or spiral (hilbert)
+  --max-depth N         Number of bounces of a path (100)
+  --seed N              Seed of the random sequences (0)
+  --scene-cache FILE    Keep the BVH of the scene in FILE between runs
+  --stats               Print statistics of the render
+
+Processes:
+  --workers N           Render with N local worker processes
+  --serve SOCKET        Render the requests sent to SOCKET until stopped
+  --submit SOCKET       Ask the server at SOCKET for the frame
+  --stop SOCKET         Stop the server at SOCKET
+  --help                Print this help
+)";
+
+/// Everything the command line chooses
+struct Options {
+  size_t width = 800;
+  size_t height = 600;
+  size_t sample_per_pixel = 500;
+  std::string output = "test.png";
+  std::optional<std::uint32_t> first_sample;
+  std::optional<std::chrono::milliseconds> time_budget;
+
+  Render_settings render;
+  std::string scene_cache; ///< No cache if empty
+  bool print_statistics = false;
+  bool print_help = false;
+
+  size_t worker_count = 0;
+  std::string worker_socket; ///< Set in the processes --workers starts
+  std::string serve_socket;
+  std::string submit_socket;
+  std::string stop_socket;
+};
+
+/// An invalid command line, reported along with the usage
+struct Usage_error : public std::invalid_argument {
+  explicit Usage_error(const std::string& message)
+      : std::invalid_argument{message}
+  {
+  }
+};
+
+bool ends_with(std::string_view s, std::string_view suffix)
+{
+  return s.size() >= suffix.size() &&
+         s.substr(s.size() - suffix.size()) == suffix;
+}
+
+size_t parse_count(std::string_view flag, const std::string& value)
+{
+  size_t end = 0;
+  unsigned long long count = 0;
+  try {
+    count = std::stoull(value, &end);
+  }
+  catch (const std::logic_error&) {
+    end = 0;
+  }
+  if (end == 0 || end != value.size() || value.front() == '-' ||
+      count > std::numeric_limits<size_t>::max()) {
+    throw Usage_error{"Invalid value for " + std::string{flag} + ": " +
+                      value};
+  }
+  return static_cast<size_t>(count);
+}
+
+// Films count the samples of a pixel in 32 bits
+std::uint32_t parse_sample_count(std::string_view flag,
+                                 const std::string& value)
+{
+  const auto count = parse_count(flag, value);
+  if (count > std::numeric_limits<std::uint32_t>::max()) {
+    throw Usage_error{std::string{flag} + " must be below 2^32"};
+  }
+  return static_cast<std::uint32_t>(count);
+}
+
+Tile_order parse_tile_order(const std::string& value)
+{
+  if (value == "rows") {
+    return Tile_order::row_major;
+  }
+  if (value == "hilbert") {
+    return Tile_order::hilbert;
+  }
+  if (value == "spiral") {
+    return Tile_order::spiral;
+  }
+  throw Usage_error{"Unknown tile order " + value};
+}
+
+// Rejects the options that the process mode of the command line, if any,
+// would ignore, given the flags that were passed
+void check_process_mode(const std::vector<std::string_view>& flags,
+                        const Options& options)
+{
+  struct Process_mode {
+    std::string_view flag;
+    std::vector<std::string_view> options;
+  };
+  static const Process_mode modes[] = {
+      {"--serve",
+       {"--threads", "--tile-size", "--tile-order", "--max-depth", "--seed",
+        "--scene-cache"}},
+      {"--stop", {}},
+      {"--submit", {"--width", "--height", "--spp", "--output"}},
+      {"--worker", {"--threads", "--width", "--height", "--scene-cache"}},
+      {"--workers",
+       {"--width", "--height", "--spp", "--output", "--threads",
+        "--tile-size", "--tile-order", "--max-depth", "--seed",
+        "--scene-cache"}},
+  };
+  const auto given = [&](std::string_view flag) {
+    return std::find(flags.begin(), flags.end(), flag) != flags.end();
+  };
+
+  for (const auto& mode : modes) {
+    if (!given(mode.flag)) {
+      continue;
+    }
+    for (const auto flag : flags) {
+      if (flag != mode.flag && flag != "--help" &&
+          std::find(mode.options.begin(), mode.options.end(), flag) ==
+              mode.options.end()) {
+        throw Usage_error{std::string{flag} + " cannot be used with " +
+                          std::string{mode.flag}};
+      }
+    }
+    // Both save the frame as an image
+    if ((mode.flag == "--submit" || mode.flag == "--workers") &&
+        !ends_with(options.output, ".png")) {
+      throw Usage_error{std::string{mode.flag} + " renders into a .png image"};
+    }
+  }
+}
+
+/// @throw Usage_error if the command line is invalid
+Options parse_options(int argc, char* argv[])
+{
+  Options options;
+  std::vector<std::string_view> flags;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view flag = argv[i];
+    flags.push_back(flag);
+    if (flag == "--help") {
+      options.print_help = true;
+      continue;
+    }
+    if (flag == "--stats") {
+      options.print_statistics = true;
+      continue;
+    }
 
-  Path_tracer path_tracer;
+    if (i + 1 == argc) {
+      throw Usage_error{"Missing value for " + std::string{flag}};
+    }
+    const std::string value = argv[++i];
+    if (flag == "--width") {
+      options.width = parse_count(flag, value);
+    }
+    else if (flag == "--height") {
+      options.height = parse_count(flag, value);
+    }
+    else if (flag == "--spp") {
+      options.sample_per_pixel = parse_sample_count(flag, value);
+    }
+    else if (flag == "--output") {
+      options.output = value;
+    }
+    else if (flag == "--first-sample") {
+      options.first_sample = parse_sample_count(flag, value);
+    }
+    else if (flag == "--time-budget") {
+      options.time_budget = std::chrono::milliseconds{
+          static_cast<std::int64_t>(parse_count(flag, value))};
+    }
+    else if (flag == "--threads") {
+      options.render.thread_count = parse_count(flag, value);
+    }
+    else if (flag == "--tile-size") {
+      options.render.tile_size = parse_count(flag, value);
+    }
+    else if (flag == "--tile-order") {
+      options.render.tile_order = parse_tile_order(value);
+    }
+    else if (flag == "--max-depth") {
+      options.render.max_depth = parse_count(flag, value);
+    }
+    else if (flag == "--seed") {
+      options.render.seed = parse_count(flag, value);
+    }
+    else if (flag == "--scene-cache") {
+      options.scene_cache = value;
+    }
+    else if (flag == "--workers") {
+      options.worker_count = parse_count(flag, value);
+    }
+    else if (flag == "--worker") {
+      options.worker_socket = value;
+    }
+    else if (flag == "--serve") {
+      options.serve_socket = value;
+    }
+    else if (flag == "--submit") {
+      options.submit_socket = value;
+    }
+    else if (flag == "--stop") {
+      options.stop_socket = value;
+    }
+    else {
+      throw Usage_error{"Unknown option " + std::string{flag}};
+    }
+  }
 
-  constexpr int width = 800, height = 600;
-  Image image(width, height);
+  if (options.width == 0 || options.height == 0) {
+    throw Usage_error{"The image must not be empty"};
+  }
+  if (options.render.tile_size == 0) {
+    throw Usage_error{"The tile size must be positive"};
+  }
+  if (!ends_with(options.output, ".png") &&
+      !ends_with(options.output, ".ptfm") &&
+      !ends_with(options.output, ".ptti")) {
+    throw Usage_error{"The output must be a .png, .ptfm or .ptti file"};
+  }
+  if (options.first_sample && !ends_with(options.output, ".ptfm")) {
+    throw Usage_error{"--first-sample renders into a .ptfm film"};
+  }
+  if (options.first_sample &&
+      *options.first_sample >= options.sample_per_pixel) {
+    throw Usage_error{"--first-sample must be below --spp"};
+  }
+  if (options.time_budget && !ends_with(options.output, ".png")) {
+    throw Usage_error{"--time-budget renders into a .png image"};
+  }
+  check_process_mode(flags, options);
+  return options;
+}
 
-  constexpr auto aspect_ratio = static_cast<float>(width) / height;
-  Camera camera{
+Camera create_camera(const Options& options)
+{
+  const auto aspect_ratio = static_cast<float>(options.width) /
+                            static_cast<float>(options.height);
+  return Camera{
       {278, 278, -800}, {278, 278, 0}, {0, 1, 0}, 40.0_deg, aspect_ratio};
-  const auto scene = create_scene();
+}
 
-  const auto start = std::chrono::system_clock::now();
-  path_tracer.run(scene, camera, image, 500);
-  const auto end = std::chrono::system_clock::now();
+#ifndef _WIN32
+// Starts count copies of this program as workers of the coordinator at
+// socket_path, sharing the hardware threads between them
+std::vector<pid_t> spawn_workers(const char* program,
+                                 const std::string& socket_path,
+                                 const Options& options)
+{
+  const auto count = options.worker_count;
+  const auto threads = options.render.thread_count != 0
+                           ? options.render.thread_count
+                           : std::thread::hardware_concurrency();
 
-  std::puts("elapsed time: ");
-  print_elapse_time(end - start);
+  // Workers render with the settings the coordinator sends, but create the
+  // camera themselves
+  std::vector<std::string> args{program,
+                                "--worker",
+                                socket_path,
+                                "--threads",
+                                std::to_string(std::max<size_t>(
+                                    threads / count, 1)),
+                                "--width",
+                                std::to_string(options.width),
+                                "--height",
+                                std::to_string(options.height)};
+  // The coordinator wrote the cache before, the workers only read it
+  if (!options.scene_cache.empty()) {
+    args.insert(args.end(), {"--scene-cache", options.scene_cache});
+  }
+  std::vector<char*> argv;
+  for (auto& arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  std::vector<pid_t> workers;
+  for (size_t i = 0; i < count; ++i) {
+    pid_t pid{};
+    if (posix_spawnp(&pid, program, nullptr, nullptr, argv.data(),
+                     environ) != 0) {
+      throw std::runtime_error{"Cannot start a worker"};
+    }
+    workers.push_back(pid);
+  }
+  return workers;
+}
 
-  std::string filename{"test.png"};
-  image.saveto(filename);
-  std::cout << "Save image to " << filename << ".\n";
+// Runs the modes that talk to other processes, returns false if none was
+// chosen
+bool run_process_mode(const Options& options, const char* program)
+{
+  const auto start = std::chrono::steady_clock::now();
+  if (!options.serve_socket.empty()) {
+    constexpr size_t scene_capacity = 4;
+    Render_server server{[&options](const std::string& name) {
+                           if (name != "cornell_box") {
+                             throw std::invalid_argument{"Unknown scene " +
+                                                         name};
+                           }
+                           return create_scene(options.scene_cache, true);
+                         },
+                         scene_capacity, options.render};
+    server.serve(options.serve_socket);
+    return true;
+  }
+  if (!options.stop_socket.empty()) {
+    send_stop_request(options.stop_socket);
+    return true;
+  }
+  if (!options.submit_socket.empty()) {
+    Render_request request;
+    request.scene = "cornell_box";
+    request.output = options.output;
+    request.width = options.width;
+    request.height = options.height;
+    request.sample_per_pixel = options.sample_per_pixel;
+    request.position = {278, 278, -800};
+    request.lookat = {278, 278, 0};
+    const auto reply = send_render_request(options.submit_socket, request);
+    if (!reply.ok) {
+      throw std::runtime_error{"Render failed: " + reply.message};
+    }
+    std::puts("elapsed time: ");
+    print_elapse_time(std::chrono::steady_clock::now() - start);
+    return true;
+  }
+  if (!options.worker_socket.empty()) {
+    run_worker(options.worker_socket,
+               create_scene(options.scene_cache, false),
+               create_camera(options), options.render.thread_count);
+    return true;
+  }
+  if (options.worker_count > 0) {
+    Coordinator_settings settings{
+        "pathtracer-" + std::to_string(getpid()) + ".sock", options.render};
+    // Workers writing the cache at the same time would race on its file
+    if (!options.scene_cache.empty()) {
+      create_scene(options.scene_cache, true);
+    }
+    const auto workers = spawn_workers(program, settings.socket_path, options);
+    Image image(options.width, options.height);
+    run_coordinator(settings, image, options.sample_per_pixel);
+    for (const auto pid : workers) {
+      waitpid(pid, nullptr, 0);
+    }
+    std::puts("elapsed time: ");
+    print_elapse_time(std::chrono::steady_clock::now() - start);
+    image.saveto(options.output);
+    return true;
+  }
+  return false;
+}
+#endif
+
+// Shows the progress of the renders of path_tracer on bar, with the time left
+void show_progress(Path_tracer& path_tracer, indicators::ProgressBar& bar)
+{
+  bar.set_bar_width(50);
+  bar.start_bar_with("[");
+  bar.fill_bar_progress_with("=");
+  bar.lead_bar_progress_with(">");
+  bar.fill_bar_remainder_with(" ");
+  bar.end_bar_with("]");
+  bar.set_postfix_text("Rendering");
+  bar.set_foreground_color(indicators::Color::GREEN);
+
+  path_tracer.set_progress_callback([&bar](const Render_progress& progress) {
+    if (progress.fraction > 0) {
+      const auto seconds_left = static_cast<long long>(
+          std::ceil(progress.remaining().count()));
+      bar.set_postfix_text("Rendering, " + std::to_string(seconds_left) +
+                           " s left");
+    }
+    bar.set_progress(progress.fraction * 100);
+  });
+}
+
+void print_statistics(const Options& options, size_t thread_count,
+                      size_t sample_count,
+                      std::chrono::duration<double> elapsed_time)
+{
+  const auto samples = static_cast<double>(options.width) *
+                       static_cast<double>(options.height) *
+                       static_cast<double>(sample_count);
+  std::cout << "resolution: " << options.width << 'x' << options.height
+            << ", samples per pixel: " << sample_count << '\n'
+            << "threads: " << thread_count
+            << ", tile size: " << options.render.tile_size
+            << ", max depth: " << options.render.max_depth
+            << ", seed: " << options.render.seed << '\n'
+            << "samples per second: " << samples / elapsed_time.count()
+            << '\n';
+}
+
+int main(int argc, char* argv[])
+try {
+  const auto options = parse_options(argc, argv);
+  if (options.print_help) {
+    std::fputs(usage, stdout);
+    return 0;
+  }
+
+#ifndef _WIN32
+  if (run_process_mode(options, argv[0])) {
+    return 0;
+  }
+#endif
+
+  const auto scene = create_scene(options.scene_cache, true);
+  const auto camera = create_camera(options);
+  Path_tracer path_tracer{options.render};
+  indicators::ProgressBar progress_bar;
+  show_progress(path_tracer, progress_bar);
+  const auto start = std::chrono::steady_clock::now();
+
+  // Samples taken per pixel by this render
+  size_t sample_count = options.sample_per_pixel;
+  if (ends_with(options.output, ".ptfm")) {
+    Film film(options.width, options.height, options.render.seed,
+              options.first_sample.value_or(0));
+    path_tracer.run(scene, camera, film, options.sample_per_pixel);
+    film.save(options.output);
+    sample_count -= std::min<size_t>(film.first_sample(), sample_count);
+  }
+  else if (ends_with(options.output, ".ptti")) {
+    // Tiles go to the file as they are finished, the frame is never whole
+    // in memory
+    Tiled_image_writer writer(options.output, options.width, options.height,
+                              options.render.tile_size);
+    path_tracer.run(scene, camera, writer, options.sample_per_pixel);
+    writer.close();
+  }
+  else if (options.time_budget) {
+    Image image(options.width, options.height);
+    sample_count =
+        path_tracer.run(scene, camera, image, start + *options.time_budget,
+                        options.sample_per_pixel);
+    image.saveto(options.output, path_tracer.thread_pool());
+    std::cout << "samples per pixel within the budget: " << sample_count
+              << '\n';
+  }
+  else {
+    Image image(options.width, options.height);
+    path_tracer.run(scene, camera, image, options.sample_per_pixel);
+    image.saveto(options.output, path_tracer.thread_pool());
+  }
+  const auto elapsed_time = std::chrono::steady_clock::now() - start;
+
+  std::puts("elapsed time: ");
+  print_elapse_time(elapsed_time);
+  if (options.print_statistics) {
+    print_statistics(options, path_tracer.thread_count(), sample_count,
+                     elapsed_time);
+  }
+  std::cout << "Save output to " << options.output << ".\n";
   return 0;
 }
 catch (const Cannot_write_file& e) {
@@ -105,9 +612,13 @@ catch (const Cannot_write_file& e) {
 }
 catch (const Unsupported_image_extension& e) {
   std::cerr << "Unsupported image extension: " << e.what() << '\n';
-  std::fputs("Currently: only ppm output is supported", stderr);
+  std::fputs("Currently: only png output is supported", stderr);
   return -2;
 }
+catch (const Usage_error& e) {
+  std::cerr << "Error: " << e.what() << "\n\n" << usage;
+  return -3;
+}
 catch (const std::exception& e) {
   std::cerr << "Error: " << e.what() << '\n';
   throw e;
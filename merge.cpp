@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "film.hpp"
+#include "image.hpp"
+
+namespace {
+bool ends_with(const std::string& s, const std::string& suffix)
+{
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+} // anonymous namespace
+
+// Usage: PathTracerMerge OUTPUT INPUT...
+//
+// Merges films of the same frame rendered over different sample ranges. The
+// output is a film if its name ends with .ptfm, and the developed image
+// otherwise.
+int main(int argc, char* argv[])
+try {
+  if (argc < 3) {
+    std::fputs("Usage: PathTracerMerge OUTPUT INPUT...\n", stderr);
+    return 1;
+  }
+
+  std::vector<Film> films;
+  for (int i = 2; i < argc; ++i) {
+    films.push_back(Film::load(argv[i]));
+  }
+
+  // The inputs may be given in any order, the sample ranges may not overlap
+  std::stable_sort(films.begin(), films.end(),
+                   [](const Film& lhs, const Film& rhs) {
+                     return lhs.first_sample() < rhs.first_sample();
+                   });
+  auto& merged = films.front();
+  for (size_t i = 1; i < films.size(); ++i) {
+    merged.merge(films[i]);
+  }
+
+  const std::string output = argv[1];
+  if (ends_with(output, ".ptfm")) {
+    merged.save(output);
+  }
+  else {
+    Image image(merged.width(), merged.height());
+    merged.develop(image);
+    image.saveto(output);
+  }
+  std::cout << "Merged " << films.size() << " films into " << output
+            << ", min samples per pixel: " << merged.min_sample_count()
+            << '\n';
+  return 0;
+}
+catch (const Cannot_write_file& e) {
+  std::cerr << "Cannot write to file: " << e.what() << '\n';
+  return -1;
+}
+catch (const Unsupported_image_extension& e) {
+  std::cerr << "Unsupported image extension: " << e.what() << '\n';
+  return -2;
+}
+catch (const std::exception& e) {
+  std::cerr << "Error: " << e.what() << '\n';
+  return -3;
+}